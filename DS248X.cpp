@@ -24,25 +24,73 @@ SOFTWARE.
 
 #include "DS248X.h"
 
+#if defined(MBED_CONF_DS248X_STATS)
+  #define DS248X_STATS_ADD(field, value) _stats.field += (value)
+  #define DS248X_STATS_OP(op) OpTimer op_timer(this, op)
+#else
+  #define DS248X_STATS_ADD(field, value)
+  #define DS248X_STATS_OP(op)
+#endif
+
+DS248X::Session::Session(DS248X *bridge) : _bridge(bridge) {
+  // bridge first, then bus, always in this order
+  _bridge->_mutex.lock();
+
+  if (_bridge->_session++ == 0) {
+    _bridge->_bus->lock();
+  }
+}
+
+DS248X::Session::Session(DS248X *bridge, uint8_t channel) : Session(bridge) {
+  _ok = _bridge->selectChannel(channel);
+}
+
+DS248X::Session::~Session(void) {
+  if (--_bridge->_session == 0) {
+    _bridge->_bus->unlock();
+  }
+
+  _bridge->_mutex.unlock();
+}
+
 DS248X::DS248X(uint8_t address) : _address(address) {}
 
+#if defined(__MBED__)
 DS248X::DS248X(PinName sda, PinName scl, uint8_t address, uint32_t frequency) : _address(address) {
-  _i2c = new (_i2c_buffer) I2C(sda, scl);
-  _i2c->frequency(frequency);
+  I2C *i2c = new (_i2c_buffer) I2C(sda, scl);
+  i2c->frequency(frequency);
+  _i2c.attach(i2c);
 }
+#endif
 
 DS248X::~DS248X(void) {
-  if (_i2c == reinterpret_cast<I2C *>(_i2c_buffer)) {
-    _i2c->~I2C();
+#if defined(__MBED__)
+  if (_i2c.get() == reinterpret_cast<I2C *>(_i2c_buffer)) {
+    _i2c.get()->~I2C();
   }
+#endif
 }
 
+#if defined(__MBED__)
 bool DS248X::init(I2C *i2c_obj) {
   if (i2c_obj != nullptr) {
-    _i2c = i2c_obj;
+    _i2c.attach(i2c_obj);
+  }
+
+  MBED_ASSERT(_i2c.get());
+
+  return init(&_i2c);
+}
+#endif
+
+bool DS248X::init(DS248XTransport *transport) {
+  if (transport != nullptr) {
+    _bus = transport;
   }
 
-  MBED_ASSERT(_i2c);
+  MBED_ASSERT(_bus);
+
+  Session session(this);
 
   memset(_rom, 0, sizeof(_rom));
 
@@ -51,61 +99,146 @@ bool DS248X::init(I2C *i2c_obj) {
     return false;
   }
 
+  detectType();
+
+  // clears the power-on RST, so a later one means the bridge reset itself
+  _config = _config_wanted;
+
+  if (!sendConfig()) {
+    tr_error("Could not set config");
+    return false;
+  }
+
   tr_info("Init successful, config: %02X", _config);
   return true;
 }
 
 bool DS248X::setConfig(ds248x_config_t type) {
+  Session session(this);
+  if (_config != UCHAR_MAX && (_config & type) == type) {
+    return true;
+  }
+
   _config |= type;
+  _config_wanted = _config & ~DS248X_CONFIG_SPU;
   return sendConfig();
 }
 
 bool DS248X::clearConfig(ds248x_config_t type) {
+  Session session(this);
+  if (_config != UCHAR_MAX && (_config & type) == 0) {
+    return true;
+  }
+
   _config &= ~(type);
+  _config_wanted = _config & ~DS248X_CONFIG_SPU;
   return sendConfig();
 }
 
 bool DS248X::selectChannel(uint8_t channel) {
-  char buf[2];
-  int32_t ack = -1;
-  uint8_t read_channel = (channel | (~channel) << 3) & ~(1 << 6);
+  Session session(this);
 
-  if (channel >= 8) {
+  if (channel >= channelCount()) {
     tr_error("Invalid channel: %u", channel);
     return false;
   }
 
-  channel |= (~channel) << 4;
+  // 0xC3 is not a channel select on single channel devices (A1WP on DS2484)
+  if (channelCount() == 1) {
+    _channel = 0;
+    _channel_known = true;
+    return true;
+  }
 
-  buf[0] = (char)CMD_CHSL;
-  buf[1] = channel;
+  if (_channel_known && channel == _channel) {
+    return true;
+  }
 
-  _i2c->lock();
-  ack = _i2c->write(_address, buf, 2, true);
+  if (!sendChannel(channel)) {
+    return false;
+  }
 
-  if (ack == 0) {
-    ack = _i2c->read(_address, buf, 1);
+  saveSearch();
+  _channel = channel;
+  loadSearch();
+  resetAlarmSearch();
+
+  tr_info("Channel set to: %u", channel);
+  return true;
+}
+
+void DS248X::detectType() {
+  char buf[2];
+
+  // a read pointer code the device doesn't have is not acknowledged
+  buf[0] = CMD_SRP;
+  buf[1] = (char)POINTER_CHANNEL;
+
+  if (_bus->write(_address, buf, 2) == 0) {
+    _type = TypeDS2482_800;
+    _pointer = POINTER_CHANNEL;
+
+  } else {
+    buf[1] = (char)POINTER_PORT;
+
+    if (_bus->write(_address, buf, 2) == 0) {
+      _type = TypeDS2484;
+      _pointer = POINTER_PORT;
+
+    } else {
+      _type = TypeDS2482_100;
+      _pointer = 0;
+    }
   }
 
-  _i2c->unlock();
+  tr_info("Device type: %s",
+          (_type == TypeDS2482_800) ? "DS2482-800" : ((_type == TypeDS2484) ? "DS2484" : "DS2482-100"));
+}
 
-  if (ack != 0) {
+bool DS248X::sendChannel(uint8_t channel) {
+  char buf[2];
+  bool ack = false;
+  uint8_t read_channel = (channel | (~channel) << 3) & ~(1 << 6);
+
+  buf[0] = (char)CMD_CHSL;
+  buf[1] = channel | (~channel) << 4;
+
+  // read pointer is at channel selection register afterwards
+  ack = deviceWriteBytes(buf, 2, true) && deviceReadBytes(buf, 1);
+
+  _channel_known = false;
+
+  if (!ack) {
     tr_error("Select channel failed");
     return false;
   }
 
-  if (buf[0] != read_channel) {
+  if (static_cast<uint8_t>(buf[0]) != read_channel) {
     tr_error("Requested channel not selected");
     return false;
   }
 
-  resetSearch();
-
-  tr_info("Channel set to: %u", channel & 0b1111);
+  _channel_known = true;
   return true;
 }
 
 bool DS248X::deviceReset() {
+  Session session(this);
+  bool success = resetDevice();
+
+  // DS2482-800 falls back to channel 0, RST stays set until the config is written
+  _channel = 0;
+  _channel_known = success;
+  _config_wanted = 0;
+  _reset_latched = true;
+  _resume_valid = 0;
+  resetSearch();
+  resetAlarmSearch();
+
+  return success;
+}
+
+bool DS248X::resetDevice() {
   char buf[1];
   buf[0] = (char)CMD_DRST;
 
@@ -115,7 +248,9 @@ bool DS248X::deviceReset() {
     return false;
   }
 
-  resetSearch();
+  // DS2484 port is back at power-on values
+  memset(&_port, DS248X_PORT_DEFAULT, sizeof(_port));
+  updateTiming();
 
   if (!deviceReadBytes(buf)) {
     return false;
@@ -129,15 +264,98 @@ bool DS248X::deviceReset() {
   return true;
 }
 
-char DS248X::computeCRC(const char *data, size_t len) {
-  MbedCRC<0x31, 8> ct(0, 0, true, true);
-  uint32_t crc = 0;
+bool DS248X::recover() {
+  Session session(this);
+  ds248x_port_t port = _port;
+  bool latched = _reset_latched;
+  char buf[1];
+
+  tr_warning("Recovering bridge");
+
+  // 1-Wire reset is enough if the bridge still answers
+  _fault = false;
+  buf[0] = (char)CMD_1WRS;
+
+  if (wireCommand(buf, 1, buf) && !_fault) {
+    DS248X_STATS_ADD(bus_recoveries, 1);
+
+    // unless the bridge reset itself meanwhile, config and channel are gone then
+    if (!(buf[0] & DS248X_STATUS_RST)) {
+      return true;
+    }
+
+  } else if (!latched && _reset_latched) {
+    // the bridge reset itself, the status read which saw it restored the bridge already
+    DS248X_STATS_ADD(device_recoveries, 1);
+
+    if (!_restore_failed) {
+      _fault = false;
+      return true;
+    }
+
+  } else if (resetDevice()) {
+    DS248X_STATS_ADD(device_recoveries, 1);
+
+  } else {
+    tr_error("Recovery failed");
+    DS248X_STATS_ADD(recovery_failures, 1);
+    return false;
+  }
+
+  _fault = false;
+
+  if (!restore(&port)) {
+    DS248X_STATS_ADD(recovery_failures, 1);
+    return false;
+  }
+
+  return true;
+}
+
+bool DS248X::restore(const ds248x_port_t *port) {
+  // the bridge is at channel 0 without config now, search state stays
+  if (_channel != 0 && !sendChannel(_channel)) {
+    return false;
+  }
+
+  _channel_known = true;
+
+  if (_port_known && !setPort(port)) {
+    return false;
+  }
 
-  if (ct.compute(data, len, &crc) == 0) {
-    return static_cast<char>(crc);
+  if (_config_wanted == UCHAR_MAX) {
+    return true;
+  }
+
+  _config = _config_wanted;
+  return sendConfig();
+}
+
+bool DS248X::retry(uint8_t attempt) {
+  microseconds backoff = DS248X_TIME_SLOT * (1 << attempt);
+
+  if (attempt >= MBED_CONF_DS248X_RETRIES || !_fault) {
+    return false;
   }
 
-  return UCHAR_MAX;
+  if (backoff > microseconds(MBED_CONF_DS248X_RETRY_BACKOFF)) {
+    backoff = microseconds(MBED_CONF_DS248X_RETRY_BACKOFF);
+  }
+
+  tr_warning("Retrying after %lld us", backoff.count());
+  DS248X_STATS_ADD(retries, 1);
+
+  _bus->wait(backoff);
+
+  // next attempt fails fast if the bridge is still gone, backoff grows
+  recover();
+
+  return true;
+}
+
+char DS248X::computeCRC(const char *data, size_t len) {
+  return static_cast<char>(DS248XCRC::crc8(data, len));
 }
 
 bool DS248X::crc8(const char *data, size_t len) {
@@ -148,10 +366,25 @@ bool DS248X::crc8(const char *data, size_t len) {
     return true;
   }
 
-  tr_error("Checksum failed");
+  tr_debug("Checksum failed");
   return false;
 }
 
+void DS248X::crcFailed() {
+  Session session(this);
+
+  tr_error("Checksum failed");
+  DS248X_STATS_ADD(crc_errors, 1);
+  pushEvent(EventCrcError);
+  _fault = true;
+
+  // corrupted at overdrive, next reset() brings everything back to standard speed
+  if (_config & DS248X_CONFIG_WS) {
+    tr_warning("Falling back to standard speed");
+    clearConfig(OverdriveSpeed);
+  }
+}
+
 void DS248X::attach(Callback<void(char)> function) {
   if (function) {
     _callback = function;
@@ -161,65 +394,152 @@ void DS248X::attach(Callback<void(char)> function) {
   }
 }
 
+bool DS248X::getEvent(ds248x_event_t *event) {
+  uint8_t tail = _event_tail.load(std::memory_order_relaxed);
+
+  MBED_ASSERT(event);
+
+  if (tail == _event_head.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  *event = _events[tail];
+  _event_tail.store((tail + 1) % MBED_CONF_DS248X_EVENT_QUEUE_SIZE, std::memory_order_release);
+
+  return true;
+}
+
+void DS248X::dispatchEvents() {
+  ds248x_event_t event;
+
+  while (getEvent(&event)) {
+    if (_callback) {
+      _callback(static_cast<char>(event.type));
+    }
+  }
+}
+
+uint32_t DS248X::lostEvents() const {
+  return _events_lost.load(std::memory_order_relaxed);
+}
+
 bool DS248X::writeBytes(const char *data, size_t len, bool spu) {
+  bool success = true;
+
   if (data == nullptr || len == 0) {
     tr_error("Invalid input data");
     return false;
   }
 
-  for (size_t i = 0; i < len; i++) {
-    if (!write(data[i], spu)) {
-      return false;
-    }
+  // whole block is a single I2C transaction glued by repeated starts, unless the transport
+  // frees the bus during 1-Wire activity
+  Session session(this);
+
+  // any ROM command clears RC flag of the last selected device, select() sets it again
+  if (_rom_pending) {
+    _rom_pending = false;
+    forgetSelected();
   }
 
-  return true;
+  // strong pullup ends with the next byte anyway, only the last one gets it
+  for (size_t i = 0; i < len && success; i++) {
+    success = writeByte(data[i], spu && (i == len - 1));
+  }
+
+  _bus->stop();
+
+  DS248X_STATS_ADD(i2c_transactions, 1);
+
+  return success;
+}
+
+bool DS248X::writePowered(const char *data, size_t len, microseconds hold) {
+  Session session(this);
+
+  if (!writeBytes(data, len, true)) {
+    return false;
+  }
+
+  // keep the bridge, let other bridges use the I2C bus while the device is powered
+  _bus->unlock();
+  _bus->wait(hold);
+  _bus->lock();
+
+  // strong pullup would last until the next 1-Wire command otherwise
+  return sendConfig();
 }
 
 bool DS248X::readBytes(char *buffer, size_t len, bool spu) {
+  return readBlock(buffer, len, spu, nullptr, nullptr);
+}
+
+bool DS248X::readBytes(char *buffer, size_t len, uint8_t *crc, bool spu) {
+  return readBlock(buffer, len, spu, crc, nullptr);
+}
+
+bool DS248X::readBytes(char *buffer, size_t len, uint16_t *crc, bool spu) {
+  return readBlock(buffer, len, spu, nullptr, crc);
+}
+
+bool DS248X::readBlock(char *buffer, size_t len, bool spu, uint8_t *crc8, uint16_t *crc16) {
+  bool success = true;
+
   if (buffer == nullptr || len == 0) {
     tr_error("Invalid input data");
     return false;
   }
 
-  char buf[1];
+  // whole block is a single I2C transaction glued by repeated starts, unless the transport
+  // frees the bus during 1-Wire activity
+  Session session(this);
 
   for (size_t i = 0; i < len; i++) {
-    if (!read(buf, spu)) {
-      return false;
+    success = readByte(&buffer[i], spu && (i == len - 1));
+
+    // byte of a failed read is garbage, the CRC stays at the bytes received
+    if (!success) {
+      break;
     }
 
-    buffer[i] = buf[0];
+    // no second pass over the buffer
+    if (crc8) {
+      *crc8 = DS248XCRC::update8(*crc8, buffer[i]);
+    }
+
+    if (crc16) {
+      *crc16 = DS248XCRC::update16(*crc16, buffer[i]);
+    }
   }
 
-  return true;
+  _bus->stop();
+
+  DS248X_STATS_ADD(i2c_transactions, 1);
+
+  return success;
 }
 
 bool DS248X::writeBit(bool bit) {
+  Session session(this);
   char buf[2];
 
   buf[0] = (char)CMD_1WSB;
   buf[1] = bit ? 0x80 : 0x00;
 
-  if (!deviceWriteBytes(buf, 2)) {
-    return false;
-  }
-
-  return waitBusy();
+  return wireCommand(buf, 2);
 }
 
 bool DS248X::readBit(bool spu) {
-  char buf[1];
+  Session session(this);
+  char buf[2];
 
   if (spu && !setConfig(StrongPullUp)) {
     return false;
   }
 
-  if (!writeBit(true)) {
-    return false;
-  }
+  buf[0] = (char)CMD_1WSB;
+  buf[1] = (char)0x80;
 
-  if (!waitBusy(buf)) {
+  if (!wireCommand(buf, 2, buf)) {
     return false;
   }
 
@@ -227,27 +547,76 @@ bool DS248X::readBit(bool spu) {
 }
 
 bool DS248X::reset() {
+  Session session(this);
+  DS248X_STATS_OP(OpReset);
   char buf[1];
+  uint8_t attempt = 0;
 
   tr_info("Reset");
 
-  bool spu = _config & DS248X_CONFIG_SPU;
+  // devices expect ROM command now
+  _rom_pending = true;
+
+  do {
+    _fault = false;
+
+    if ((_config & DS248X_CONFIG_SPU) && !clearConfig(StrongPullUp)) {
+      continue;
+    }
+
+    buf[0] = (char)CMD_1WRS;
+
+    if (wireCommand(buf, 1, buf)) {
+      break;
+    }
+  } while (retry(attempt++));
 
-  if (spu && !clearConfig(StrongPullUp)) {
+  if (_fault) {
     return false;
   }
 
-  buf[0] = (char)CMD_1WRS;
+  if (!(buf[0] & DS248X_STATUS_PPD) && (_config & DS248X_CONFIG_WS)) {
+    tr_warning("No presence at overdrive, falling back to standard speed");
+    return standardSpeed();
+  }
 
-  if (!deviceWriteBytes(buf)) {
+  return (buf[0] & DS248X_STATUS_PPD);
+}
+
+bool DS248X::standardSpeed() {
+  Session session(this);
+  if (!clearConfig(OverdriveSpeed)) {
     return false;
   }
 
-  if (!waitBusy(buf)) {
-    return false;
+  return reset();
+}
+
+bool DS248X::overdriveSkip() {
+  Session session(this);
+  tr_info("Overdrive skip");
+
+  if (_config & DS248X_CONFIG_WS) {
+    return skip();
   }
 
-  return (buf[0] & DS248X_STATUS_PPD);
+  // command at standard speed, the devices answer at overdrive from now on
+  return write(WIRE_COMMAND_OVERDRIVE_SKIP) && setConfig(OverdriveSpeed);
+}
+
+bool DS248X::overdriveSelect(const char *rom) {
+  Session session(this);
+  DS248X_STATS_OP(OpSelect);
+
+  tr_info("Overdrive selecting: %s", tr_array(reinterpret_cast<const uint8_t *>(rom), 8));
+
+  // devices on the bus are at overdrive already
+  if (_config & DS248X_CONFIG_WS) {
+    return select(rom);
+  }
+
+  // command at standard speed, ROM at overdrive
+  return write(WIRE_COMMAND_OVERDRIVE_SELECT) && setConfig(OverdriveSpeed) && writeBytes(rom, 8);
 }
 
 bool DS248X::skip() {
@@ -257,119 +626,307 @@ bool DS248X::skip() {
 }
 
 bool DS248X::select(const char *rom) {
+  Session session(this);
+  DS248X_STATS_OP(OpSelect);
+  char buf[9];
+  bool resume = (_resume_valid & (1 << _channel)) && memcmp(_resume_rom[_channel], rom, 8) == 0;
+
   tr_info("Selecting: %s", tr_array(reinterpret_cast<const uint8_t *>(rom), 8));
 
-  if (!write(WIRE_COMMAND_SELECT)) {
+  // the device kept its RC flag since it was matched
+  if (resume) {
+    if (!write(WIRE_COMMAND_RESUME)) {
+      return false;
+    }
+
+    DS248X_STATS_ADD(resumes, 1);
+    _resume_valid |= 1 << _channel;
+    return true;
+  }
+
+  buf[0] = WIRE_COMMAND_SELECT;
+  memcpy(&buf[1], rom, 8);
+
+  if (!writeBytes(buf, sizeof(buf))) {
     return false;
   }
 
-  return writeBytes(rom, 8);
+  rememberSelected(rom);
+  return true;
+}
+
+bool DS248X::resumable(uint8_t family) {
+  switch (family) {
+    case 0x17:  // DS28E15, DS28E22, DS28E25
+    case 0x1C:  // DS28E04
+    case 0x29:  // DS2408
+    case 0x2D:  // DS2431
+    case 0x2F:  // DS28E01
+    case 0x37:  // DS1977
+    case 0x3A:  // DS2413
+    case 0x43:  // DS28EC20
+      return true;
+
+    default:
+      return false;
+  }
 }
 
 bool DS248X::search(char *rom) {
-  uint8_t rom_byte_counter = 0;
-  uint8_t id_bit_counter = 1;
-  uint8_t last_zero = 0;
-  uint8_t rom_byte_mask = 1;
-  char buf[2];
-  bool id_bit = false;
-  bool cmp_id_bit = false;
-  bool search_direction = false;
+  return searchNext(rom, WIRE_COMMAND_SEARCH);
+}
+
+bool DS248X::alarmSearch(char *rom) {
+  Session session(this);
+  bool found;
+
+  // alarm search has its own position, search() state is parked meanwhile
+  swapSearch(&_alarm_search);
+  found = searchNext(rom, WIRE_COMMAND_ALARM_SEARCH);
+  swapSearch(&_alarm_search);
+
+  return found;
+}
+
+void DS248X::resetAlarmSearch() {
+  memset(&_alarm_search, 0, sizeof(_alarm_search));
+}
 
-  if (_last_device_flag || !reset()) {
-    tr_warning("No %sdevices on the bus", _last_device_flag ? "more " : "");
+bool DS248X::searchNext(char *rom, char command) {
+  Session session(this);
+  DS248X_STATS_OP(OpSearch);
+  uint8_t last_zero;
+  uint8_t attempt = 0;
+  bool present = false;
+  bool found;
+
+  _search_failed = false;
+
+  if (_last_device_flag) {
+    tr_warning("No more devices on the bus");
     return false;
   }
 
-  if (!write(WIRE_COMMAND_SEARCH)) {
-    goto END;
-  }
+  // failed pass is repeated from the same position
+  saveSearch();
 
-  while (rom_byte_counter < 8) {
-    if (id_bit_counter < _last_discrepancy) {
-      search_direction = ((_rom[rom_byte_counter] & rom_byte_mask) > 0);
+  do {
+    loadSearch();
+    last_zero = 0;
+    found = false;
+    present = false;
 
-    } else {
-      search_direction = (id_bit_counter == _last_discrepancy);
+    // reset() retries on its own
+    if (!reset()) {
+      tr_warning("No devices on the bus");
+      break;
     }
 
-    buf[0] = CMD_1WT;
-    buf[1] = search_direction ? 0x80 : 0x00;
+    present = true;
+
+    // fresh search starts at the first device of the prefix subtree
+    if (_prefix_bits > 0 && _last_discrepancy == 0) {
+      memcpy(_rom, _prefix, sizeof(_rom));
+      _last_discrepancy = 64;
+    }
 
-    if (!deviceWriteBytes(buf, 2)) {
-      goto END;
+    if (!searchPass(&last_zero, _prefix_bits > 0 ? _prefix : nullptr, command, _prefix_bits)) {
+      continue;
     }
 
-    if (!waitBusy(buf)) {
-      goto END;
+    // going back to a discrepancy inside the prefix would leave the subtree
+    if (last_zero <= _prefix_bits) {
+      last_zero = 0;
     }
 
-    id_bit = (buf[0] & DS248X_STATUS_SBR);
-    cmp_id_bit = (buf[0] & DS248X_STATUS_TSB);
-    search_direction = (buf[0] & DS248X_STATUS_DIR);
+    found = searchFinish(last_zero, rom);
+  } while (!found && retry(attempt++));
 
-    checkError(buf);
+  // empty bus ends the search, a short, a bridge failure or a broken pass does not
+  _search_failed = !found && (present || _fault || _short_latched);
 
-    // check for no devices on 1-Wire or short
-    if ((id_bit && cmp_id_bit) || (buf[0] & DS248X_STATUS_SD)) {
-      tr_error("No devices or SHORT on the bus");
-      goto END;
-    }
+  if (!found && !_last_device_flag) {
+    resetSearch();
+  }
 
-    if (!id_bit && !cmp_id_bit && !search_direction) {
-      last_zero = id_bit_counter;
+  return found;
+}
 
-      // check for Last discrepancy in family
-      if (last_zero < 9) {
-        _last_family_discrepancy = last_zero;
-      }
+bool DS248X::verify(const char *rom) {
+  Session session(this);
+  DS248X_STATS_OP(OpSearch);
+  uint8_t last_zero;
+  uint8_t attempt = 0;
+  bool found;
+
+  // search() continues where it stopped afterwards
+  saveSearch();
+
+  do {
+    // take the path of the ROM at every discrepancy
+    memcpy(_rom, rom, sizeof(_rom));
+    _last_discrepancy = 64;
+    last_zero = 0;
+    found = false;
+
+    if (!reset()) {
+      break;
     }
 
-    if (search_direction) {
-      _rom[rom_byte_counter] |= rom_byte_mask;
+    found = searchPass(&last_zero, rom);
+  } while (!found && retry(attempt++));
 
-    } else {
-      _rom[rom_byte_counter] &= (char)~rom_byte_mask;
-    }
+  loadSearch();
 
-    id_bit_counter++;
-    rom_byte_mask <<= 1;
+  tr_info("Device %s: %s", found ? "present" : "missing", tr_array(reinterpret_cast<const uint8_t *>(rom), 8));
+  return found;
+}
 
-    if (rom_byte_mask == 0) {
-      rom_byte_counter++;
-      rom_byte_mask = 1;
-    }
-  }
+size_t DS248X::verifyAll(const ds248x_device_t *devices, size_t count, uint8_t *present, uint8_t channels) {
+  size_t found = 0;
 
-  if (id_bit_counter < 65) {
-    goto END;
-  }
+  MBED_ASSERT(devices && present);
 
-  _last_discrepancy = last_zero;
+  Session session(this);
 
-  if (_last_discrepancy == 0) {
-    _last_device_flag = true;
+  if (channels > channelCount()) {
+    channels = channelCount();
   }
 
-  if (_rom[0] == 0) {
-    goto END;
-  }
+  memset(present, 0, (count + 7) / 8);
 
-  // compare CRC
-  if (!crc8(_rom, 8)) {
-    return false;
-  }
+  for (uint8_t channel = 0; channel < channels; channel++) {
+    bool selected = false;
 
-  if (rom) {
-    memcpy(rom, _rom, sizeof(_rom));
-  }
+    for (size_t i = 0; i < count; i++) {
+      if (devices[i].channel != channel) {
+        continue;
+      }
 
-  tr_info("Found device: %s", tr_array(reinterpret_cast<uint8_t *>(_rom), 8));
-  return true;
+      // select channel only if there is something to verify, nothing is sent if it's selected already
+      if (!selected) {
+        if (!selectChannel(channel)) {
+          break;
+        }
 
-END:
-  resetSearch();
-  return false;
+        selected = true;
+      }
+
+      if (verify(devices[i].rom)) {
+        present[i / 8] |= 1 << (i % 8);
+        found++;
+      }
+    }
+  }
+
+  return found;
+}
+
+bool DS248X::searchPass(uint8_t *last_zero, const char *expected, char command, uint8_t expected_bits) {
+  uint8_t id_bit_counter = 1;
+  uint8_t rom_byte_counter;
+  char rom_byte_mask;
+  char buf[2];
+
+  if (!write(command)) {
+    return false;
+  }
+
+  busLock();
+
+  for (; id_bit_counter <= 64; id_bit_counter++) {
+    buf[0] = CMD_1WT;
+    buf[1] = searchDirection(id_bit_counter) ? 0x80 : 0x00;
+
+    if (!wireCommand(buf, 2, buf, true) || !searchBit(id_bit_counter, buf[0], last_zero)) {
+      break;
+    }
+
+    // the bus took other branch, the expected device is not there
+    if (expected && id_bit_counter <= expected_bits) {
+      rom_byte_counter = (id_bit_counter - 1) / 8;
+      rom_byte_mask = 1 << ((id_bit_counter - 1) % 8);
+
+      if ((_rom[rom_byte_counter] ^ expected[rom_byte_counter]) & rom_byte_mask) {
+        break;
+      }
+    }
+  }
+
+  _bus->stop();
+  busUnlock();
+
+  DS248X_STATS_ADD(i2c_transactions, 1);
+
+  return (id_bit_counter > 64);
+}
+
+bool DS248X::searchDirection(uint8_t bit) const {
+  if (bit < _last_discrepancy) {
+    return _rom[(bit - 1) / 8] & (1 << ((bit - 1) % 8));
+  }
+
+  return (bit == _last_discrepancy);
+}
+
+bool DS248X::searchBit(uint8_t bit, char status, uint8_t *last_zero) {
+  uint8_t rom_byte_counter = (bit - 1) / 8;
+  char rom_byte_mask = 1 << ((bit - 1) % 8);
+  bool id_bit = (status & DS248X_STATUS_SBR);
+  bool cmp_id_bit = (status & DS248X_STATUS_TSB);
+  bool search_direction = (status & DS248X_STATUS_DIR);
+
+  checkError(&status);
+
+  // check for no devices on 1-Wire or short
+  if ((id_bit && cmp_id_bit) || (status & DS248X_STATUS_SD)) {
+    tr_error("No devices or SHORT on the bus");
+    return false;
+  }
+
+  if (!id_bit && !cmp_id_bit && !search_direction) {
+    *last_zero = bit;
+
+    // check for Last discrepancy in family
+    if (bit < 9) {
+      _last_family_discrepancy = bit;
+    }
+  }
+
+  if (search_direction) {
+    _rom[rom_byte_counter] |= rom_byte_mask;
+
+  } else {
+    _rom[rom_byte_counter] &= (char)~rom_byte_mask;
+  }
+
+  return true;
+}
+
+bool DS248X::searchFinish(uint8_t last_zero, char *rom) {
+  _last_discrepancy = last_zero;
+
+  if (_last_discrepancy == 0) {
+    _last_device_flag = true;
+  }
+
+  if (_rom[0] == 0) {
+    resetSearch();
+    return false;
+  }
+
+  // compare CRC
+  if (!crc8(_rom, 8)) {
+    crcFailed();
+    return false;
+  }
+
+  if (rom) {
+    memcpy(rom, _rom, sizeof(_rom));
+  }
+
+  tr_info("Found device: %s", tr_array(reinterpret_cast<uint8_t *>(_rom), 8));
+  return true;
 }
 
 void DS248X::resetSearch() {
@@ -382,32 +939,47 @@ void DS248X::resetSearch() {
   memset(_rom, 0, sizeof(_rom));
 }
 
-bool DS248X::deviceWriteBytes(const char *data, size_t len) {
+bool DS248X::deviceWriteBytes(const char *data, size_t len, bool repeated) {
   int32_t ack;
 
   tr_debug("Sending[%u]: %s", len, tr_array(reinterpret_cast<const uint8_t *>(data), len));
 
-  _i2c->lock();
-  ack = _i2c->write(_address, data, len);
-  _i2c->unlock();
+  busLock();
+  ack = _bus->write(_address, data, len, repeated);
+  busUnlock();
+
+  if (ack == 0) {
+    updateShadow(data, len);
+
+  } else {
+    _pointer = 0;
+  }
+
+  DS248X_STATS_ADD(i2c_transactions, repeated ? 0 : 1);
+  DS248X_STATS_ADD(i2c_bytes_written, len);
 
   if (ack != 0) {
     tr_error("Error write");
+    _fault = true;
     return false;
   }
 
   return true;
 }
 
-bool DS248X::deviceReadBytes(char *buffer, size_t len) {
+bool DS248X::deviceReadBytes(char *buffer, size_t len, bool repeated) {
   int32_t ack;
 
-  _i2c->lock();
-  ack = _i2c->read(_address, buffer, len);
-  _i2c->unlock();
+  busLock();
+  ack = _bus->read(_address, buffer, len, repeated);
+  busUnlock();
+
+  DS248X_STATS_ADD(i2c_transactions, repeated ? 0 : 1);
+  DS248X_STATS_ADD(i2c_bytes_read, len);
 
   if (ack != 0) {
     tr_error("Error read");
+    _fault = true;
     return false;
   }
 
@@ -416,15 +988,58 @@ bool DS248X::deviceReadBytes(char *buffer, size_t len) {
   return true;
 }
 
-bool DS248X::waitBusy(char *status) {
+bool DS248X::waitBusy(char *status, bool repeated) {
   char buf[1];
   int poll_count = 0;
+  microseconds now = _bus->now();
+  microseconds deadline = _busy_until + microseconds(MBED_CONF_DS248X_BUSY_TIMEOUT);
+
+  // the transport decides whether freeing the I2C bus while 1-Wire activity runs is worth
+  // addressing the status again, otherwise the status read follows by repeated start
+  if (now < _busy_until) {
+    if (_bus->hold(_busy_until - now)) {
+      _bus->wait(_busy_until - now);
+
+    } else {
+      DS248X_STATS_ADD(i2c_transactions, 1);
+
+      // a transport which queues writes sends the command only now
+      if (_bus->stop() != 0) {
+        tr_error("Error write");
+        _fault = true;
+        return false;
+      }
+
+      if (_session > 0) {
+        _bus->unlock();
+        _bus->wait(_busy_until - now);
+        _bus->lock();
+
+      } else {
+        _bus->wait(_busy_until - now);
+      }
+    }
+  }
 
-  _i2c->lock();
-  _i2c->read(_address, buf, 1);
+  busLock();
 
-  while ((buf[0] & DS248X_STATUS_1WB) && ((poll_count++) < MBED_CONF_DS248X_POLL_LIMIT)) {
-    _i2c->read(_address, buf, 1, buf[0] & DS248X_STATUS_1WB);
+  if (_pointer != POINTER_STATUS && !setReadPointer(POINTER_STATUS, true)) {
+    _bus->stop();
+    busUnlock();
+    return false;
+  }
+
+  if (_bus->read(_address, buf, 1, true) != 0) {
+    tr_error("Error read");
+    _fault = true;
+    _bus->stop();
+    busUnlock();
+    return false;
+  }
+
+  while ((buf[0] & DS248X_STATUS_1WB) && (_bus->now() < deadline) &&
+         ((poll_count++) < MBED_CONF_DS248X_POLL_LIMIT)) {
+    _bus->read(_address, buf, 1, true);
 
     // tr_debug("Status: %c%c%c%c%c%c%c%c",
     //          (buf[0] & 0x80 ? '1' : '0'),
@@ -437,30 +1052,115 @@ bool DS248X::waitBusy(char *status) {
     //          (buf[0] & 0x01 ? '1' : '0'));
   }
 
-  _i2c->stop();
-  _i2c->unlock();
+  if (!repeated) {
+    _bus->stop();
+  }
+
+  busUnlock();
+
+  DS248X_STATS_ADD(i2c_transactions, repeated ? 0 : 1);
+  DS248X_STATS_ADD(i2c_bytes_read, poll_count + 1);
+  DS248X_STATS_ADD(polls, poll_count + 1);
 
   if (status) {
     memcpy(status, buf, sizeof(buf));
   }
 
-  if (poll_count >= MBED_CONF_DS248X_POLL_LIMIT) {
+  if (buf[0] & DS248X_STATUS_1WB) {
     tr_error("Device busy timeout");
-
-    if (_callback) {
-      _callback.call(DS248X_CB_DEVICE_RESET_NEEDED);
-    }
+    DS248X_STATS_ADD(busy_timeouts, 1);
+    pushEvent(EventBusyTimeout);
+    _fault = true;
 
     return false;
   }
 
   // check for SHORT & RESET
-  checkError(buf);
+  return checkError(buf);
+}
 
-  return true;
+void DS248X::updateShadow(const char *data, size_t len) {
+  _busy_until = _bus->now() + commandTime(data[0]);
+
+  switch (static_cast<uint8_t>(data[0])) {
+    case CMD_1WRS:
+    case CMD_1WWB:
+    case CMD_1WRB:
+    case CMD_1WSB:
+    case CMD_1WT:
+      // strong pullup is consumed by the 1-Wire activity
+      if (_config != UCHAR_MAX) {
+        _config &= ~DS248X_CONFIG_SPU;
+      }
+
+      _pointer = POINTER_STATUS;
+      break;
+
+    case CMD_DRST:
+      _config = 0;
+      _pointer = POINTER_STATUS;
+      break;
+
+    case CMD_WCFG:
+      _pointer = POINTER_CONFIG;
+      break;
+
+    case CMD_CHSL:
+      _pointer = POINTER_CHANNEL;
+      break;
+
+    case CMD_SRP:
+      _pointer = (len > 1) ? static_cast<uint8_t>(data[1]) : 0;
+      break;
+
+    default:
+      _pointer = 0;
+      break;
+  }
+}
+
+bool DS248X::wireCommand(const char *data, size_t len, char *status, bool repeated) {
+  bool success = false;
+
+  // command and the status poll share one I2C transaction
+  busLock();
+
+  if (deviceWriteBytes(data, len, true)) {
+    success = waitBusy(status, repeated);
+
+  } else if (!repeated) {
+    _bus->stop();
+  }
+
+  busUnlock();
+
+  return success;
 }
 
-bool DS248X::sendConfig() {
+microseconds DS248X::commandTime(char command) const {
+  bool overdrive = _config & DS248X_CONFIG_WS;
+  nanoseconds slot = _time_slot[overdrive];
+
+  switch (static_cast<uint8_t>(command)) {
+    case CMD_1WRS:
+      return _time_reset[overdrive];
+
+    case CMD_1WWB:
+    case CMD_1WRB:
+      return duration_cast<microseconds>(slot * 8);
+
+    case CMD_1WSB:
+      return duration_cast<microseconds>(slot);
+
+    case CMD_1WT:
+      return duration_cast<microseconds>(slot * 3);
+
+    default:
+      return 0us;
+  }
+}
+
+bool DS248X::sendConfig(bool repeated) {
   char buf[2];
 
   buf[0] = (char)CMD_WCFG;
@@ -468,7 +1168,7 @@ bool DS248X::sendConfig() {
 
   tr_info("Sending config: %02X", _config);
 
-  if (!deviceWriteBytes(buf, 2)) {
+  if (!deviceWriteBytes(buf, 2, repeated)) {
     return false;
   }
 
@@ -476,6 +1176,7 @@ bool DS248X::sendConfig() {
 }
 
 bool DS248X::loadConfig() {
+  Session session(this);
   char buf[1];
 
   if (!setReadPointer(POINTER_CONFIG)) {
@@ -487,57 +1188,74 @@ bool DS248X::loadConfig() {
   }
 
   _config = buf[0];
+  _config_wanted = _config & ~DS248X_CONFIG_SPU;
   tr_info("Got config: %02X", _config);
 
   return true;
 }
 
 bool DS248X::write(char data, bool spu) {
-  if (spu && !setConfig(StrongPullUp)) {
-    return false;
-  }
+  return writeBytes(&data, 1, spu);
+}
+
+bool DS248X::read(char *buffer, bool spu) {
+  return readBytes(buffer, 1, spu);
+}
 
+bool DS248X::writeByte(char data, bool spu) {
+  DS248X_STATS_OP(OpWrite);
   char buf[2];
-  buf[0] = (char)CMD_1WWB;
-  buf[1] = data;
 
-  if (!deviceWriteBytes(buf, 2)) {
-    return false;
+  if (spu && !(_config & DS248X_CONFIG_SPU)) {
+    _config |= StrongPullUp;
+
+    if (!sendConfig(true)) {
+      return false;
+    }
   }
 
-  return waitBusy();
+  buf[0] = (char)CMD_1WWB;
+  buf[1] = data;
+
+  return wireCommand(buf, 2, nullptr, true);
 }
 
-bool DS248X::read(char *buffer, bool spu) {
-  if (spu && !setConfig(StrongPullUp)) {
-    return false;
-  }
+bool DS248X::readByte(char *buffer, bool spu) {
+  DS248X_STATS_OP(OpRead);
 
-  buffer[0] = (char)CMD_1WRB;
+  if (spu && !(_config & DS248X_CONFIG_SPU)) {
+    _config |= StrongPullUp;
 
-  if (!deviceWriteBytes(buffer)) {
-    return false;
+    if (!sendConfig(true)) {
+      return false;
+    }
   }
 
-  if (!waitBusy()) {
+  buffer[0] = (char)CMD_1WRB;
+
+  if (!wireCommand(buffer, 1, nullptr, true)) {
     return false;
   }
 
-  if (!setReadPointer(POINTER_DATA)) {
+  if (!setReadPointer(POINTER_DATA, true)) {
     return false;
   }
 
-  return deviceReadBytes(buffer, 1);
+  return deviceReadBytes(buffer, 1, true);
 }
 
-bool DS248X::setReadPointer(ds248x_pointer_t address) {
+bool DS248X::setReadPointer(ds248x_pointer_t address, bool repeated) {
   char buf[2];
   buf[0] = CMD_SRP;
   buf[1] = (char)address;
 
+  if (_pointer == address) {
+    return true;
+  }
+
   tr_debug("Setting read pointer to: %02X", address);
 
-  if (!deviceWriteBytes(buf, 2)) {
+  if (!deviceWriteBytes(buf, 2, repeated)) {
     tr_error("Setting read pointer failed");
     return false;
   }
@@ -545,40 +1263,418 @@ bool DS248X::setReadPointer(ds248x_pointer_t address) {
   return true;
 }
 
-void DS248X::checkError(char *status) {
-  static bool cb_sent[2] = {false, false};
+bool DS248X::checkError(char *status) {
+  ds248x_port_t port;
 
   if (status[0] & DS248X_STATUS_SD) {
-    if (!cb_sent[0]) {
+    if (!_short_latched) {
       tr_warning("Short condition detected");
+      DS248X_STATS_ADD(short_events, 1);
+      pushEvent(EventShort);
+      _short_latched = true;
+    }
 
-      if (_callback) {
-        _callback.call(DS248X_CB_SHORT_CONDITION);
+    // devices might have lost power
+    forgetSelected();
+
+  } else {
+    _short_latched = false;
+  }
+
+  if (status[0] & DS248X_STATUS_RST) {
+    // device lost its config and channel, pointer is at status as we just read it
+    _config = 0;
+    _pointer = POINTER_STATUS;
+    _channel_known = false;
+
+    if (!_reset_latched) {
+      tr_warning("Reset condition detected");
+      // power-on, devices might have lost RC flag too
+      _resume_valid = 0;
+      DS248X_STATS_ADD(reset_events, 1);
+      pushEvent(EventReset);
+      _reset_latched = true;
+      _fault = true;
+
+      // DS2484 port is back at power-on values too, the shadow keeps the requested ones
+      port = _port;
+      memset(&_port, DS248X_PORT_DEFAULT, sizeof(_port));
+      updateTiming();
+
+      _restore_failed = !restore(&port);
+
+      if (_restore_failed) {
+        tr_error("Restoring bridge failed");
       }
 
-      cb_sent[0] = true;
+      return false;
     }
 
   } else {
-    cb_sent[0] = false;
+    _reset_latched = false;
   }
 
-  if (status[0] & DS248X_STATUS_RST) {
-    if (!cb_sent[1]) {
-      tr_warning("Reset condition detected");
+  return true;
+}
 
-      if (_callback) {
-        _callback.call(DS248X_CB_RESET_CONDITION);
+void DS248X::pushEvent(ds248x_event_type_t type) {
+  uint8_t head = _event_head.load(std::memory_order_relaxed);
+  uint8_t next = (head + 1) % MBED_CONF_DS248X_EVENT_QUEUE_SIZE;
+
+  if (next == _event_tail.load(std::memory_order_acquire)) {
+    _events_lost.store(_events_lost.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return;
+  }
+
+  _events[head].time = _bus->now();
+  _events[head].type = type;
+  _events[head].channel = _channel;
+  _event_head.store(next, std::memory_order_release);
+}
+
+DS248X::ds248x_enum_result_t DS248X::enumerateAll(ds248x_device_t *devices, size_t size, size_t *count,
+                                                  microseconds *bus_time, uint8_t channels) {
+  microseconds start = _bus->now();
+  size_t found = 0;
+  ds248x_enum_result_t result = EnumFull;
+  bool failed;
+  bool more;
+
+  MBED_ASSERT(devices && count);
+
+  Session session(this);
+
+  if (channels > channelCount()) {
+    channels = channelCount();
+  }
+
+  while (_enum_channel < channels) {
+    if (found == size) {
+      tr_info("Enumeration table full");
+      break;
+    }
+
+    if (!selectChannel(_enum_channel)) {
+      tr_error("Enumeration of channel %u failed", _enum_channel);
+      resetEnumeration();
+      result = EnumFailed;
+      break;
+    }
+
+    // own position, search() of the user on this channel is parked meanwhile
+    swapSearch(&_enum_search);
+
+    while (found < size && search(devices[found].rom)) {
+      devices[found].channel = _enum_channel;
+      found++;
+    }
+
+    failed = _search_failed;
+    more = !_last_device_flag;
+    swapSearch(&_enum_search);
+
+    // a device which didn't make it through the search would be missing silently
+    if (failed) {
+      tr_error("Search of channel %u failed", _enum_channel);
+      resetEnumeration();
+      result = EnumFailed;
+      break;
+    }
+
+    // the table got full but there are more devices on this channel
+    if (found == size && more) {
+      continue;
+    }
+
+    memset(&_enum_search, 0, sizeof(_enum_search));
+    _enum_channel++;
+  }
+
+  if (_enum_channel >= channels) {
+    _enum_channel = 0;
+    result = EnumComplete;
+  }
+
+  *count = found;
+
+  if (bus_time) {
+    *bus_time = _bus->now() - start;
+  }
+
+  tr_info("Enumerated %u devices", found);
+  return result;
+}
+
+void DS248X::resetEnumeration() {
+  _enum_channel = 0;
+
+  memset(&_enum_search, 0, sizeof(_enum_search));
+}
+
+bool DS248X::readPort(ds248x_port_t *port) {
+  Session session(this);
+  char buf[8];
+
+  MBED_ASSERT(port);
+
+  // reading starts at the first parameter after setting the pointer only
+  _pointer = 0;
+
+  if (!setReadPointer(POINTER_PORT) || !deviceReadBytes(buf, sizeof(buf))) {
+    tr_error("1-Wire port not available");
+    return false;
+  }
+
+  _port.reset_low[0] = buf[0] & 0x0F;
+  _port.reset_low[1] = buf[1] & 0x0F;
+  _port.presence_sample[0] = buf[2] & 0x0F;
+  _port.presence_sample[1] = buf[3] & 0x0F;
+  _port.write_zero_low[0] = buf[4] & 0x0F;
+  _port.write_zero_low[1] = buf[5] & 0x0F;
+  _port.recovery = buf[6] & 0x0F;
+  _port.pullup = buf[7] & 0x0F;
+  _port_known = true;
+
+  updateTiming();
+  *port = _port;
+
+  return true;
+}
+
+bool DS248X::adjustPort(ds248x_port_param_t param, uint8_t value, bool overdrive) {
+  Session session(this);
+  ds248x_port_t port;
+  char buf[2];
+
+  if (value > 0x0F) {
+    tr_error("Invalid port value: %u", value);
+    return false;
+  }
+
+  // same command is channel select of DS2482-800, make sure it's DS2484
+  if (!_port_known && !readPort(&port)) {
+    return false;
+  }
+
+  buf[0] = (char)CMD_A1WP;
+  buf[1] = (param << 5) | (overdrive ? 0x10 : 0) | value;
+
+  if (!deviceWriteBytes(buf, 2)) {
+    return false;
+  }
+
+  _pointer = POINTER_PORT;
+
+  switch (param) {
+    case PortResetLow:
+      _port.reset_low[overdrive] = value;
+      break;
+
+    case PortPresenceSample:
+      _port.presence_sample[overdrive] = value;
+      break;
+
+    case PortWriteZeroLow:
+      _port.write_zero_low[overdrive] = value;
+      break;
+
+    case PortRecovery:
+      _port.recovery = value;
+      break;
+
+    case PortPullUp:
+      _port.pullup = value;
+      break;
+  }
+
+  updateTiming();
+
+  tr_info("Port parameter %u set to %u", param, value);
+  return true;
+}
+
+bool DS248X::setPort(const ds248x_port_t *port) {
+  Session session(this);
+
+  MBED_ASSERT(port);
+
+  for (uint8_t od = 0; od < 2; od++) {
+    if (!adjustPort(PortResetLow, port->reset_low[od], od) ||
+        !adjustPort(PortPresenceSample, port->presence_sample[od], od) ||
+        !adjustPort(PortWriteZeroLow, port->write_zero_low[od], od)) {
+      return false;
+    }
+  }
+
+  return adjustPort(PortRecovery, port->recovery) && adjustPort(PortPullUp, port->pullup);
+}
+
+bool DS248X::tunePort(const ds248x_device_t *devices, size_t count, ds248x_port_t *port, uint8_t rounds) {
+  Session session(this);
+  static const ds248x_port_param_t params[] = {PortRecovery, PortResetLow};
+  bool overdrive = _config & DS248X_CONFIG_WS;
+  ds248x_port_t tuned;
+  uint8_t *value;
+  uint8_t minimum;
+
+  MBED_ASSERT(devices && count > 0);
+
+  if (!readPort(&tuned)) {
+    return false;
+  }
+
+  if (!probePort(devices, count, rounds)) {
+    tr_error("Devices not found with current timing");
+    return false;
+  }
+
+  for (auto param : params) {
+    value = (param == PortRecovery) ? &tuned.recovery : &tuned.reset_low[overdrive];
+    minimum = (param == PortRecovery) ? DS248X_PORT_RECOVERY_MIN : DS248X_PORT_RESET_LOW_MIN;
+
+    while (*value > minimum) {
+      if (!adjustPort(param, *value - 1, overdrive)) {
+        return false;
       }
 
-      cb_sent[1] = true;
+      if (!probePort(devices, count, rounds)) {
+        break;
+      }
+
+      (*value)--;
     }
 
-  } else {
-    cb_sent[1] = false;
+    // back to the last reliable value
+    if (!adjustPort(param, *value, overdrive)) {
+      return false;
+    }
+  }
+
+  tr_info("Tuned tREC0 %u, tRSTL %u", tuned.recovery, tuned.reset_low[overdrive]);
+
+  if (port) {
+    *port = tuned;
+  }
+
+  return true;
+}
+
+bool DS248X::probePort(const ds248x_device_t *devices, size_t count, uint8_t rounds) {
+  for (uint8_t round = 0; round < rounds; round++) {
+    for (size_t i = 0; i < count; i++) {
+      if (!verify(devices[i].rom)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+nanoseconds DS248X::portTime(ds248x_port_param_t param, uint8_t value, bool overdrive) {
+  value &= 0x0F;
+
+  switch (param) {
+    case PortResetLow:
+      return overdrive ? (44000ns + value * 2000ns) : (440000ns + value * 20000ns);
+
+    case PortWriteZeroLow:
+      // upper codes saturate at 10 us / 70 us
+      if (overdrive) {
+        return 5000ns + (value < 10 ? value : 10) * 500ns;
+      }
+
+      return 52000ns + (value < 9 ? value : 9) * 2000ns;
+
+    case PortRecovery:
+      if (value < DS248X_PORT_DEFAULT) {
+        return 2750ns;
+      }
+
+      return 5250ns + (value - DS248X_PORT_DEFAULT) * 2500ns;
+
+    default:
+      return 0ns;
+  }
+}
+
+void DS248X::updateTiming() {
+  nanoseconds reset;
+  nanoseconds slot;
+
+  // datasheet bus timing shifted by the difference to power-on parameters
+  for (uint8_t od = 0; od < 2; od++) {
+    reset = portTime(PortResetLow, _port.reset_low[od], od) - portTime(PortResetLow, DS248X_PORT_DEFAULT, od);
+    slot = portTime(PortWriteZeroLow, _port.write_zero_low[od], od) -
+           portTime(PortWriteZeroLow, DS248X_PORT_DEFAULT, od) + portTime(PortRecovery, _port.recovery) -
+           portTime(PortRecovery, DS248X_PORT_DEFAULT);
+
+    _time_reset[od] = (od ? DS248X_TIME_RESET_OD : DS248X_TIME_RESET) + duration_cast<microseconds>(reset);
+    _time_slot[od] = (od ? DS248X_TIME_SLOT_OD : DS248X_TIME_SLOT) + slot;
+  }
+}
+
+void DS248X::wait(microseconds time) {
+  _bus->wait(time);
+}
+
+void DS248X::busLock() {
+  if (_session == 0) {
+    _bus->lock();
+  }
+}
+
+void DS248X::busUnlock() {
+  if (_session == 0) {
+    _bus->unlock();
+  }
+}
+
+void DS248X::saveSearch() {
+  ds248x_search_t &state = _searches[_channel];
+
+  memcpy(state.rom, _rom, sizeof(_rom));
+  state.last_discrepancy = _last_discrepancy;
+  state.last_family_discrepancy = _last_family_discrepancy;
+  state.last_device_flag = _last_device_flag;
+}
+
+void DS248X::swapSearch(ds248x_search_t *state) {
+  ds248x_search_t current;
+
+  memcpy(current.rom, _rom, sizeof(_rom));
+  current.last_discrepancy = _last_discrepancy;
+  current.last_family_discrepancy = _last_family_discrepancy;
+  current.last_device_flag = _last_device_flag;
+
+  memcpy(_rom, state->rom, sizeof(_rom));
+  _last_discrepancy = state->last_discrepancy;
+  _last_family_discrepancy = state->last_family_discrepancy;
+  _last_device_flag = state->last_device_flag;
+
+  *state = current;
+}
+
+void DS248X::forgetSelected() {
+  _resume_valid &= ~(1 << _channel);
+}
+
+void DS248X::rememberSelected(const char *rom) {
+  if (resumable(rom[0])) {
+    memcpy(_resume_rom[_channel], rom, 8);
+    _resume_valid |= 1 << _channel;
   }
 }
 
+void DS248X::loadSearch() {
+  const ds248x_search_t &state = _searches[_channel];
+
+  memcpy(_rom, state.rom, sizeof(_rom));
+  _last_discrepancy = state.last_discrepancy;
+  _last_family_discrepancy = state.last_family_discrepancy;
+  _last_device_flag = state.last_device_flag;
+}
+
 void DS248X::searchFamily(uint8_t family_code) {
   memset(_rom, 0, sizeof(_rom));
 
@@ -586,4 +1682,61 @@ void DS248X::searchFamily(uint8_t family_code) {
   _last_discrepancy = 64;
   _last_family_discrepancy = 0;
   _last_device_flag = false;
-}
\ No newline at end of file
+}
+
+void DS248X::searchPrefix(const char *prefix, uint8_t bits) {
+  memset(_prefix, 0, sizeof(_prefix));
+  _prefix_bits = (prefix != nullptr) ? ((bits > 64) ? 64 : bits) : 0;
+
+  if (_prefix_bits > 0) {
+    memcpy(_prefix, prefix, (_prefix_bits + 7) / 8);
+
+    // clear bits behind the prefix
+    if (_prefix_bits % 8) {
+      _prefix[_prefix_bits / 8] &= (char)((1 << (_prefix_bits % 8)) - 1);
+    }
+  }
+
+  resetSearch();
+}
+
+void DS248X::skipFamily() {
+  _last_discrepancy = _last_family_discrepancy;
+  _last_family_discrepancy = 0;
+
+  if (_last_discrepancy == 0) {
+    _last_device_flag = true;
+  }
+}
+
+#if defined(MBED_CONF_DS248X_STATS)
+void DS248X::getStats(ds248x_stats_t *stats) const {
+  memcpy(stats, &_stats, sizeof(_stats));
+}
+
+void DS248X::resetStats() {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+DS248X::OpTimer::OpTimer(DS248X *parent, ds248x_op_t op) : _parent(parent), _op(op) {
+  _start = _parent->_bus->now();
+}
+
+DS248X::OpTimer::~OpTimer(void) {
+  ds248x_histogram_t &histogram = _parent->_stats.latency[_op];
+  uint32_t time = (_parent->_bus->now() - _start).count();
+  uint8_t bucket = 0;
+
+  while (bucket < (DS248X_STATS_BUCKETS - 1) && time >= (128UL << bucket)) {
+    bucket++;
+  }
+
+  histogram.count++;
+  histogram.total_us += time;
+  histogram.buckets[bucket]++;
+
+  if (time > histogram.max_us) {
+    histogram.max_us = time;
+  }
+}
+#endif
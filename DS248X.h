@@ -25,11 +25,29 @@ SOFTWARE.
 #ifndef DS248X_H
 #define DS248X_H
 
+#include <atomic>
 #include <chrono>
 #include <climits>
+#include <cstring>
 
-#include "mbed-trace/mbed_trace.h"
-#include "mbed.h"
+#if defined(__MBED__)
+  #include "mbed-trace/mbed_trace.h"
+  #include "mbed.h"
+#else
+  #include <cassert>
+  #include <functional>
+  #include <mutex>
+
+template <typename F>
+using Callback = std::function<F>;
+using PlatformMutex = std::recursive_mutex;
+
+  #define MBED_ASSERT(expr) assert(expr)
+  #undef MBED_CONF_DS248X_DEBUG
+#endif
+
+#include "DS248XCRC.h"
+#include "DS248XTransport.h"
 
 using namespace std::chrono;
 
@@ -48,6 +66,40 @@ using namespace std::chrono;
     {}
 #endif
 
+#if !defined(MBED_CONF_DS248X_POLL_LIMIT)
+  #define MBED_CONF_DS248X_POLL_LIMIT 200
+#endif
+
+#if !defined(MBED_CONF_DS248X_BUSY_TIMEOUT)
+  #define MBED_CONF_DS248X_BUSY_TIMEOUT 5000
+#endif
+
+#if !defined(MBED_CONF_DS248X_RETRIES)
+  #define MBED_CONF_DS248X_RETRIES 2
+#endif
+
+#if !defined(MBED_CONF_DS248X_RETRY_BACKOFF)
+  #define MBED_CONF_DS248X_RETRY_BACKOFF 2000
+#endif
+
+#if !defined(MBED_CONF_DS248X_EVENT_QUEUE_SIZE)
+  #define MBED_CONF_DS248X_EVENT_QUEUE_SIZE 16
+#endif
+
+#if MBED_CONF_DS248X_EVENT_QUEUE_SIZE < 2 || MBED_CONF_DS248X_EVENT_QUEUE_SIZE > 256
+  #error "ds248x.event_queue_size must be between 2 and 256"
+#endif
+
+// 1-Wire timing of the bridge, standard / overdrive speed
+#define DS248X_TIME_RESET 1148us
+#define DS248X_TIME_RESET_OD 146us
+#define DS248X_TIME_SLOT 73us
+#define DS248X_TIME_SLOT_OD 11us
+
+#define DS248X_PORT_DEFAULT 0b0110        // power-on value of DS2484 port parameters
+#define DS248X_PORT_RECOVERY_MIN 0b0101   // lower tREC0 codes are all 2.75 us
+#define DS248X_PORT_RESET_LOW_MIN 0b0010  // tRSTL 480 us (48 us at overdrive), minimum of 1-Wire spec
+
 #define DS248X_DEFAULT_ADDRESS (0x18 << 1)
 
 #define DS248X_CONFIG_APU (1 << 0)
@@ -64,22 +116,137 @@ using namespace std::chrono;
 #define DS248X_STATUS_TSB (1 << 6)
 #define DS248X_STATUS_DIR (1 << 7)
 
+#define DS248X_CHANNELS 8
+
+#define DS248X_STATS_BUCKETS 12  // upper bound of bucket n is 128us << n, last one is unbounded
+
 #define DS248X_CB_SHORT_CONDITION 1
 #define DS248X_CB_RESET_CONDITION 2
 #define DS248X_CB_DEVICE_RESET_NEEDED 3
+#define DS248X_CB_CRC_ERROR 4
 
 class DS248X {
  public:
   typedef enum {
     ActivePullUp = DS248X_CONFIG_APU,
     StrongPullUp = DS248X_CONFIG_SPU,
-    OverdriveSpeed = DS248X_CONFIG_WS  // perform reset() after setting this
+    OverdriveSpeed = DS248X_CONFIG_WS  // perform reset() after setting this, see overdriveSkip() and overdriveSelect()
   } ds248x_config_t;
 
+  typedef struct {
+    uint8_t channel;
+    char rom[8];
+  } ds248x_device_t;
+
+  typedef enum { TypeUnknown = 0, TypeDS2482_100, TypeDS2482_800, TypeDS2484 } ds248x_type_t;
+
+  typedef enum {
+    EnumComplete = 0,  // all channels enumerated
+    EnumFull,          // the table got full, call again to continue
+    EnumFailed         // channel not selected or searched, the next call starts from the first channel
+  } ds248x_enum_result_t;
+
+  typedef enum {
+    PortResetLow = 0,        // tRSTL
+    PortPresenceSample = 1,  // tMSP
+    PortWriteZeroLow = 2,    // tW0L
+    PortRecovery = 3,        // tREC0, same for both speeds
+    PortPullUp = 4           // RWPU
+  } ds248x_port_param_t;
+
+  // 4-bit codes of DS2484 1-Wire port parameters, [0] standard, [1] overdrive speed
+  typedef struct {
+    uint8_t reset_low[2];
+    uint8_t presence_sample[2];
+    uint8_t write_zero_low[2];
+    uint8_t recovery;
+    uint8_t pullup;
+  } ds248x_port_t;
+
+  typedef enum {
+    EventShort = DS248X_CB_SHORT_CONDITION,
+    EventReset = DS248X_CB_RESET_CONDITION,
+    EventBusyTimeout = DS248X_CB_DEVICE_RESET_NEEDED,
+    EventCrcError = DS248X_CB_CRC_ERROR
+  } ds248x_event_type_t;
+
+  typedef struct {
+    microseconds time;  // time of the bus
+    ds248x_event_type_t type;
+    uint8_t channel;
+  } ds248x_event_t;
+
+#if defined(MBED_CONF_DS248X_STATS)
+  typedef enum { OpReset, OpWrite, OpRead, OpSearch, OpSelect, OpCount } ds248x_op_t;
+
+  typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t buckets[DS248X_STATS_BUCKETS];
+  } ds248x_histogram_t;
+
+  typedef struct {
+    uint32_t i2c_transactions;
+    uint32_t i2c_bytes_written;
+    uint32_t i2c_bytes_read;
+    uint32_t polls;  // status reads in waitBusy()
+    uint32_t busy_timeouts;
+    uint32_t crc_errors;
+    uint32_t short_events;
+    uint32_t reset_events;
+    uint32_t retries;
+    uint32_t bus_recoveries;     // bridge answered after 1-Wire reset
+    uint32_t device_recoveries;  // bridge had to be reset
+    uint32_t recovery_failures;
+    uint32_t resumes;                     // select() sent Resume instead of Match ROM
+    ds248x_histogram_t latency[OpCount];  // nested calls are counted too, ie. select() adds to write
+  } ds248x_stats_t;
+#endif
+
+  /**
+   * @brief Exclusive use of the bridge (and channel) for its lifetime, so a
+   * reset, select, command, read sequence can't be interleaved by other
+   * threads. Operations inside the session don't lock the I2C bus again.
+   * Sessions nest, but don't open session of another bridge inside one.
+   */
+  class Session {
+   public:
+    Session(DS248X* bridge);
+
+    /**
+     * @brief Open session and select channel (DS2482-800)
+     *
+     * @param bridge bridge to own
+     * @param channel channel to select
+     */
+    Session(DS248X* bridge, uint8_t channel);
+    ~Session(void);
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    /**
+     * @brief Whether the channel got selected
+     *
+     * @return true if successful, otherwise false
+     */
+    bool ok() const {
+      return _ok;
+    }
+
+   private:
+    DS248X* _bridge;
+    bool _ok = true;
+  };
+
   DS248X(uint8_t address = DS248X_DEFAULT_ADDRESS);
+#if defined(__MBED__)
   DS248X(PinName sda, PinName scl, uint8_t address = DS248X_DEFAULT_ADDRESS, uint32_t frequency = 400000);
+#endif
   virtual ~DS248X(void);
 
+#if defined(__MBED__)
   /**
    * @brief Initialise the chip
    *
@@ -87,6 +254,16 @@ class DS248X {
    * @return true if successful, otherwise false
    */
   bool init(I2C* i2c_obj = nullptr);
+#endif
+
+  /**
+   * @brief Initialise the chip over custom transport (ie. simulator),
+   * the device type is detected by the read pointer codes it accepts
+   *
+   * @param transport bus to talk through
+   * @return true if successful, otherwise false
+   */
+  bool init(DS248XTransport* transport);
 
   /**
    * @brief Set configuration
@@ -112,7 +289,10 @@ class DS248X {
   bool loadConfig();
 
   /**
-   * @brief Select channel for DS248X-800 only
+   * @brief Select channel for DS248X-800 only, search state of each
+   * channel is kept so search() continues where it stopped on that channel.
+   * Nothing is sent if the channel is selected already or the device
+   * has a single channel.
    *
    * @param channel
    * @return true if successful, otherwise false
@@ -120,12 +300,49 @@ class DS248X {
   bool selectChannel(uint8_t channel);
 
   /**
-   * @brief Reset the device
+   * @brief Get the device type detected by init()
+   *
+   * @return device type
+   */
+  ds248x_type_t getType() const {
+    return _type;
+  }
+
+  /**
+   * @brief Get the number of 1-Wire channels of the device
+   *
+   * @return 8 for DS2482-800, otherwise 1
+   */
+  uint8_t channelCount() const {
+    return (_type == TypeDS2482_800) ? DS248X_CHANNELS : 1;
+  }
+
+  /**
+   * @brief Get the selected channel
+   *
+   * @return channel
+   */
+  uint8_t getChannel() const {
+    return _channel;
+  }
+
+  /**
+   * @brief Reset the device, config and channel go back to 0
    *
    * @return true if successful, otherwise false
    */
   bool deviceReset();
 
+  /**
+   * @brief Bring the bridge back after I2C or busy timeout error by 1-Wire reset,
+   * if it doesn't answer by device reset. Requested config (without strong pullup),
+   * channel, port and search state are restored. Called by operations which start
+   * with 1-Wire reset (reset, search, verify) before they are retried.
+   *
+   * @return true if successful, otherwise false
+   */
+  bool recover();
+
   /**
    * @brief Compute CRC
    *
@@ -136,21 +353,52 @@ class DS248X {
   static char computeCRC(const char* data, size_t len = 8);
 
   /**
-   * @brief Check if CRC math the data
+   * @brief Check if CRC math the data, no side effects (see crcFailed())
    *
    * @param data a pointer to the data block where the last byte is the CRC
    * @param len the size of the data
    * @return true if CRC math, otherwise false
    */
-  bool crc8(const char* data, size_t len);
+  static bool crc8(const char* data, size_t len);
+
+  /**
+   * @brief Report data read from the bus which failed its CRC, counts it, queues
+   * EventCrcError and falls back to standard speed if the bus runs at overdrive
+   *
+   */
+  void crcFailed();
 
   /**
-   * @brief Attach callback for events
+   * @brief Attach callback for events, it is called from dispatchEvents()
+   * with the event type, never from the I/O path
    *
    * @param function callback
    */
   void attach(Callback<void(char)> function);
 
+  /**
+   * @brief Take the oldest bus event (short, reset, busy timeout, CRC failure),
+   * may be called from other thread than the one using the bridge, but only from one
+   *
+   * @param event place to put the event
+   * @return true if there was an event, otherwise false
+   */
+  bool getEvent(ds248x_event_t* event);
+
+  /**
+   * @brief Drain the events and pass them to the attached callback, call it from
+   * the application thread (the callback may use the bridge)
+   *
+   */
+  void dispatchEvents();
+
+  /**
+   * @brief Number of events dropped because the queue was full
+   *
+   * @return count
+   */
+  uint32_t lostEvents() const;
+
   // 1-Wire commands
   /**
    * @brief Write single byte to 1-wire bus
@@ -171,25 +419,66 @@ class DS248X {
   bool read(char* buffer, bool spu = false);
 
   /**
-   * @brief Write multiple bytes to 1-wire bus
+   * @brief Write multiple bytes to 1-wire bus, the whole block is sent
+   * in a single I2C transaction (unless the transport frees the bus during 1-Wire
+   * activity, see DS248XTransport::hold()) and the bus is locked meanwhile
    *
    * @param data a pointer to the data block
    * @param len the size of the data to be written
-   * @param spu whether to assert strong pullup
+   * @param spu whether to assert strong pullup after the last byte
    * @return true if successful, otherwise false
    */
   bool writeBytes(const char* data, size_t len, bool spu = false);
 
   /**
-   * @brief Read multiple bytes from 1-wire bus
+   * @brief Write block and power the bus by strong pullup after the last byte
+   * (Convert T, Copy Scratchpad of parasite powered devices), the pullup is
+   * released after the hold time. The I2C bus is free for other bridges meanwhile,
+   * channel of this one can't change as it would cut the power.
+   *
+   * @param data a pointer to the data block
+   * @param len the size of the data to be written
+   * @param hold how long the device needs the power
+   * @return true if successful, otherwise false
+   */
+  bool writePowered(const char* data, size_t len, microseconds hold);
+
+  /**
+   * @brief Read multiple bytes from 1-wire bus, the whole block is read
+   * in a single I2C transaction (unless the transport frees the bus during 1-Wire
+   * activity, see DS248XTransport::hold()) and the bus is locked meanwhile
    *
    * @param buffer place to put the reading
    * @param len size of data to read (make sure it fits into buffer)
-   * @param spu whether to assert strong pullup
+   * @param spu whether to assert strong pullup after the last byte
    * @return true if successful, otherwise false
    */
   bool readBytes(char* buffer, size_t len, bool spu = false);
 
+  /**
+   * @brief Read multiple bytes and fold them into running CRC8,
+   * it is 0 after reading data followed by its CRC8
+   *
+   * @param buffer place to put the reading
+   * @param len size of data to read (make sure it fits into buffer)
+   * @param crc running CRC8, start with 0
+   * @param spu whether to assert strong pullup after the last byte
+   * @return true if successful, otherwise false
+   */
+  bool readBytes(char* buffer, size_t len, uint8_t* crc, bool spu = false);
+
+  /**
+   * @brief Read multiple bytes and fold them into running CRC16, it is
+   * DS248X_CRC16_RESIDUE after reading data followed by its inverted CRC16
+   *
+   * @param buffer place to put the reading
+   * @param len size of data to read (make sure it fits into buffer)
+   * @param crc running CRC16, start with 0 or the CRC of the command sent
+   * @param spu whether to assert strong pullup after the last byte
+   * @return true if successful, otherwise false
+   */
+  bool readBytes(char* buffer, size_t len, uint16_t* crc, bool spu = false);
+
   /**
    * @brief Write bit to 1-wire bus
    *
@@ -221,13 +510,51 @@ class DS248X {
   bool skip();
 
   /**
-   * @brief Select device on 1-wire bus
+   * @brief Overdrive Skip ROM, all overdrive capable devices get selected
+   * and switch to overdrive speed together with the bridge, call after reset()
+   *
+   * @return true if successful, otherwise false
+   */
+  bool overdriveSkip();
+
+  /**
+   * @brief Overdrive Match ROM, select device and switch it to overdrive
+   * speed together with the bridge, call after reset(). If already at
+   * overdrive, plain Match ROM is used.
+   *
+   * @param rom unique address of device
+   * @return true if successful, otherwise false
+   */
+  bool overdriveSelect(const char* rom);
+
+  /**
+   * @brief Bring the bridge and all devices back to standard speed by
+   * standard speed reset. Done automatically when there is no presence
+   * at overdrive, after CRC failure at overdrive the next reset() is at
+   * standard speed.
+   *
+   * @return true if device on the bus, false if no device/error
+   */
+  bool standardSpeed();
+
+  /**
+   * @brief Select device on 1-wire bus, call after reset(). If the device
+   * was the last one selected on the channel and supports it, Resume is sent
+   * instead of Match ROM and the ROM.
    *
    * @param rom unique address of device
    * @return true if successful, otherwise false
    */
   bool select(const char* rom);
 
+  /**
+   * @brief Check if devices of the family support Resume (0xA5)
+   *
+   * @param family family code (first byte of ROM)
+   * @return true if supported, otherwise false
+   */
+  static bool resumable(uint8_t family);
+
   /**
    * @brief Search for device on 1-wire bus
    *
@@ -236,12 +563,47 @@ class DS248X {
    */
   bool search(char* rom);
 
+  /**
+   * @brief Check that device is on the bus by single search pass,
+   * state of search() is kept
+   *
+   * @param rom unique address of device
+   * @return true if device on the bus, otherwise false
+   */
+  bool verify(const char* rom);
+
+  /**
+   * @brief Check list of devices, one search pass per device
+   *
+   * @param devices devices to check
+   * @param count number of devices
+   * @param present place to put the bitmap of present devices, bit n%8 of byte n/8 is device n
+   * @param channels number of channels, limited to channelCount()
+   * @return number of present devices
+   */
+  size_t verifyAll(const ds248x_device_t* devices, size_t count, uint8_t* present, uint8_t channels = DS248X_CHANNELS);
+
   /**
    * @brief Reset search for next usage
    *
    */
   void resetSearch();
 
+  /**
+   * @brief Search for device in alarm state (Alarm Search), keeps
+   * its own position independent of search(), restarts on channel change
+   *
+   * @param rom place to put the unique address of device (8 bytes)
+   * @return true if successful, otherwise false
+   */
+  bool alarmSearch(char* rom);
+
+  /**
+   * @brief Reset alarm search for next usage
+   *
+   */
+  void resetAlarmSearch();
+
   /**
    * @brief Set a family code for the next search.
    * If on it's on the bus it will be the first
@@ -251,6 +613,118 @@ class DS248X {
    */
   void searchFamily(uint8_t family_code);
 
+  /**
+   * @brief Limit search() and alarmSearch() to devices whose ROM starts
+   * with the prefix, the search ends as soon as it leaves the prefix subtree
+   *
+   * @param prefix ROM prefix, bit 0 of the first byte goes first (nullptr to search all devices)
+   * @param bits length of the prefix in bits, 8 for family code
+   */
+  void searchPrefix(const char* prefix, uint8_t bits = 8);
+
+  /**
+   * @brief Skip the remaining devices of the family found by the last
+   * search(), the next search() continues with next family
+   *
+   */
+  void skipFamily();
+
+  /**
+   * @brief Enumerate devices on all channels, if the table gets full
+   * the next call continues where this one stopped. The last enumerated
+   * channel stays selected.
+   *
+   * @param devices table to fill
+   * @param size capacity of the table
+   * @param count place to put the number of devices stored in this call
+   * @param bus_time place to put the time spent on the bus in this call (optional)
+   * @param channels number of channels to enumerate, limited to channelCount()
+   * @return EnumComplete if all channels were enumerated, EnumFull if the table got full,
+   * EnumFailed if a channel could not be selected or its search failed (devices stored so far are valid)
+   */
+  ds248x_enum_result_t enumerateAll(ds248x_device_t* devices, size_t size, size_t* count,
+                                    microseconds* bus_time = nullptr, uint8_t channels = DS248X_CHANNELS);
+
+  /**
+   * @brief Restart enumerateAll() from the first channel
+   *
+   */
+  void resetEnumeration();
+
+  /**
+   * @brief Read 1-Wire port parameters (DS2484 only)
+   *
+   * @param port place to put the parameters
+   * @return true if successful, otherwise false
+   */
+  bool readPort(ds248x_port_t* port);
+
+  /**
+   * @brief Adjust 1-Wire port parameter (DS2484 only), bus timing
+   * expected by the driver follows
+   *
+   * @param param parameter
+   * @param value 4-bit code, see DS2484 datasheet
+   * @param overdrive whether to set the overdrive value (tRSTL, tMSP, tW0L)
+   * @return true if successful, otherwise false
+   */
+  bool adjustPort(ds248x_port_param_t param, uint8_t value, bool overdrive = false);
+
+  /**
+   * @brief Write all 1-Wire port parameters (DS2484 only), ie. profile from tunePort()
+   *
+   * @param port parameters
+   * @return true if successful, otherwise false
+   */
+  bool setPort(const ds248x_port_t* port);
+
+  /**
+   * @brief Shorten recovery and reset low time of current speed step by step
+   * while all the devices pass verify(), the fastest reliable values stay set
+   * (DS2484 only). Only codes which differ in timing and keep tRSTL in spec
+   * are tried. Device reset restores power-on values, keep the profile.
+   *
+   * @param devices devices which must be found, all on the selected channel
+   * @param count number of devices
+   * @param port place to put the tuned profile (optional)
+   * @param rounds how many times each step must pass
+   * @return true if successful, otherwise false
+   */
+  bool tunePort(const ds248x_device_t* devices, size_t count, ds248x_port_t* port = nullptr, uint8_t rounds = 3);
+
+  /**
+   * @brief Time of 1-Wire port parameter code
+   *
+   * @param param parameter (tRSTL, tW0L or tREC0)
+   * @param value 4-bit code
+   * @param overdrive overdrive speed
+   * @return time, 0 for other parameters
+   */
+  static nanoseconds portTime(ds248x_port_param_t param, uint8_t value, bool overdrive = false);
+
+  /**
+   * @brief Wait without occupying the I2C bus (ie. for temperature conversion),
+   * other threads can use the bridge only if called outside Session
+   *
+   * @param time how long to wait
+   */
+  void wait(microseconds time);
+
+#if defined(MBED_CONF_DS248X_STATS)
+  /**
+   * @brief Get performance counters and latency histograms
+   *
+   * @param stats place to put the snapshot
+   */
+  void getStats(ds248x_stats_t* stats) const;
+
+  /**
+   * @brief Clear performance counters and latency histograms
+   *
+   */
+  void resetStats();
+#endif
+
  protected:
   typedef enum {
     CMD_1WT = 0x78,   // 1-Wire triplet
@@ -259,75 +733,383 @@ class DS248X {
     CMD_1WWB = 0xA5,  // 1-Wire write byte
     CMD_1WRS = 0xB4,  // 1-Wire reset
     CMD_CHSL = 0xC3,  // channel select
+    CMD_A1WP = 0xC3,  // adjust 1-Wire port (DS2484)
     CMD_WCFG = 0xD2,  // write configuration
     CMD_SRP = 0xE1,   // set read pointer
     CMD_DRST = 0xF0,  // device reset
   } ds248x_cmd_t;
 
-  typedef enum { POINTER_CONFIG = 0xC3, POINTER_DATA = 0xE1, POINTER_STATUS = 0xF0 } ds248x_pointer_t;
+  typedef enum {
+    POINTER_PORT = 0xB4,
+    POINTER_CONFIG = 0xC3,
+    POINTER_CHANNEL = 0xD2,
+    POINTER_DATA = 0xE1,
+    POINTER_STATUS = 0xF0
+  } ds248x_pointer_t;
 
-  typedef enum { WIRE_COMMAND_SELECT = 0x55, WIRE_COMMAND_SKIP = 0xCC, WIRE_COMMAND_SEARCH = 0xF0 } ds248x_wire_cmd_t;
+  typedef enum {
+    WIRE_COMMAND_OVERDRIVE_SKIP = 0x3C,
+    WIRE_COMMAND_SELECT = 0x55,
+    WIRE_COMMAND_OVERDRIVE_SELECT = 0x69,
+    WIRE_COMMAND_RESUME = 0xA5,
+    WIRE_COMMAND_SKIP = 0xCC,
+    WIRE_COMMAND_ALARM_SEARCH = 0xEC,
+    WIRE_COMMAND_SEARCH = 0xF0
+  } ds248x_wire_cmd_t;
 
   /**
    * @brief Send current config to device
    *
+   * @param repeated whether to keep the I2C transaction open
    * @return true if successful, otherwise false
    */
-  bool sendConfig();
+  bool sendConfig(bool repeated = false);
 
   /**
    * @brief Set the read pointer from where to read the data
    *
    * @param address where to read from
+   * @param repeated whether to keep the I2C transaction open
    * @return true if successful, otherwise false
    */
-  bool setReadPointer(ds248x_pointer_t address);
+  bool setReadPointer(ds248x_pointer_t address, bool repeated = false);
 
  protected:
   char _rom[8] = {0};
-  char _config = UCHAR_MAX;
+  uint8_t _config = UCHAR_MAX;         // shadow of config register, UCHAR_MAX if unknown
+  uint8_t _config_wanted = UCHAR_MAX;  // config set by the user (without strong pullup), restored after reset
+  uint8_t _pointer = 0;                // shadow of read pointer, 0 if unknown
   /**
    * @brief Write data to device
    *
    * @param data a pointer to the data block
    * @param len the size of the data to be written
+   * @param repeated whether to keep the I2C transaction open
    * @return true if successful, otherwise false
    */
-  bool deviceWriteBytes(const char* data, size_t len = 1);
+  bool deviceWriteBytes(const char* data, size_t len = 1, bool repeated = false);
 
   /**
    * @brief Read the data from device
    *
    * @param buffer place to put the reading
    * @param len size of data to read (make sure it fits into buffer)
+   * @param repeated whether to keep the I2C transaction open
    * @return true if successful, otherwise false
    */
-  bool deviceReadBytes(char* buffer, size_t len = 1);
+  bool deviceReadBytes(char* buffer, size_t len = 1, bool repeated = false);
 
   /**
-   * @brief Wait until device not busy
+   * @brief Wait until device not busy, sleeps for the expected duration
+   * of the last 1-Wire command and confirms by polling the status
    *
    * @param status place to put the reading (1 byte)
+   * @param repeated whether to keep the I2C transaction open
+   * @return true if successful, otherwise false
+   */
+  bool waitBusy(char* status = nullptr, bool repeated = false);
+
+  /**
+   * @brief Write single byte to 1-wire bus and leave the I2C transaction open,
+   * caller is responsible for locking the bus and the STOP condition
+   *
+   * @param data byte to send
+   * @param spu whether to assert strong pullup
    * @return true if successful, otherwise false
    */
-  bool waitBusy(char* status = nullptr);
+  bool writeByte(char data, bool spu);
+
+  /**
+   * @brief Read single byte from 1-wire bus and leave the I2C transaction open,
+   * caller is responsible for locking the bus and the STOP condition
+   *
+   * @param buffer place to put the reading (1 byte)
+   * @param spu whether to assert strong pullup
+   * @return true if successful, otherwise false
+   */
+  bool readByte(char* buffer, bool spu);
+
+  /**
+   * @brief Read block in single I2C transaction, optionally folding it into CRC
+   *
+   * @param buffer place to put the reading
+   * @param len size of data to read
+   * @param spu whether to assert strong pullup after the last byte
+   * @param crc8 running CRC8 (optional)
+   * @param crc16 running CRC16 (optional)
+   * @return true if successful, otherwise false
+   */
+  bool readBlock(char* buffer, size_t len, bool spu, uint8_t* crc8, uint16_t* crc16);
+
+  /**
+   * @brief Direction to take at given bit of the next search pass
+   *
+   * @param bit bit number (1-64)
+   * @return direction
+   */
+  bool searchDirection(uint8_t bit) const;
+
+  /**
+   * @brief Send Search ROM and walk all 64 bits by triplets, bus must be reset before
+   *
+   * @param last_zero place to track the last discrepancy of this pass
+   * @param expected stop as soon as the bus leaves the path of this ROM (optional)
+   * @param command search command
+   * @param expected_bits number of leading bits of expected ROM to follow
+   * @return true if all bits passed, otherwise false
+   */
+  bool searchPass(uint8_t* last_zero, const char* expected = nullptr, char command = WIRE_COMMAND_SEARCH,
+                  uint8_t expected_bits = 64);
+
+  /**
+   * @brief Find next device, the bus is reset first
+   *
+   * @param rom place to put the unique address of device (8 bytes)
+   * @param command search command
+   * @return true if device found, otherwise false
+   */
+  bool searchNext(char* rom, char command);
+
+  /**
+   * @brief Process the triplet result of one search bit
+   *
+   * @param bit bit number (1-64)
+   * @param status status register after the triplet
+   * @param last_zero place to track the last discrepancy of this pass
+   * @return true if successful, false if no devices or short
+   */
+  bool searchBit(uint8_t bit, char status, uint8_t* last_zero);
+
+  /**
+   * @brief Finish search pass after all 64 bits
+   *
+   * @param last_zero last discrepancy of this pass
+   * @param rom place to put the unique address of device (8 bytes)
+   * @return true if device found, otherwise false
+   */
+  bool searchFinish(uint8_t last_zero, char* rom);
+
+  /**
+   * @brief Track the effect of written command on the device registers
+   *
+   * @param data command followed by its parameter
+   * @param len the size of the command
+   */
+  void updateShadow(const char* data, size_t len);
+
+  /**
+   * @brief Send 1-Wire command and wait until it's done
+   *
+   * @param data command followed by its parameter
+   * @param len the size of the command
+   * @param status place to put the final status (1 byte)
+   * @param repeated whether to keep the I2C transaction open
+   * @return true if successful, otherwise false
+   */
+  bool wireCommand(const char* data, size_t len, char* status = nullptr, bool repeated = false);
+
+  /**
+   * @brief Expected duration of command at current speed
+   *
+   * @param command command code
+   * @return duration, 0 if the command doesn't use 1-Wire bus
+   */
+  microseconds commandTime(char command) const;
 
  private:
-  I2C* _i2c;
+  friend class DS248XAsync;
+
+  DS248XTransport* _bus = nullptr;
   Callback<void(char)> _callback = nullptr;
+
+  // single producer (I/O path, inside session), single consumer (getEvent)
+  ds248x_event_t _events[MBED_CONF_DS248X_EVENT_QUEUE_SIZE];
+  std::atomic<uint8_t> _event_head{0};
+  std::atomic<uint8_t> _event_tail{0};
+  std::atomic<uint32_t> _events_lost{0};
+  bool _short_latched = false;
+  bool _reset_latched = false;
+  bool _restore_failed = false;  // restore() after the bridge reset itself did not go through
+#if defined(__MBED__)
+  DS248XI2CTransport _i2c;
   uint32_t _i2c_buffer[sizeof(I2C) / sizeof(uint32_t)];
+#endif
   const char _address = DS248X_DEFAULT_ADDRESS;
 
   uint8_t _last_discrepancy = 0;
   uint8_t _last_family_discrepancy = 0;
   bool _last_device_flag = false;
+  microseconds _busy_until = 0us;
+  bool _fault = false;  // I2C error, busy timeout or CRC failure during current operation
+
+  ds248x_port_t _port = {{DS248X_PORT_DEFAULT, DS248X_PORT_DEFAULT},
+                         {DS248X_PORT_DEFAULT, DS248X_PORT_DEFAULT},
+                         {DS248X_PORT_DEFAULT, DS248X_PORT_DEFAULT},
+                         DS248X_PORT_DEFAULT,
+                         DS248X_PORT_DEFAULT};
+  bool _port_known = false;                                                 // DS2484 port read or written
+  microseconds _time_reset[2] = {DS248X_TIME_RESET, DS248X_TIME_RESET_OD};  // standard / overdrive
+  nanoseconds _time_slot[2] = {DS248X_TIME_SLOT, DS248X_TIME_SLOT_OD};
+
+  typedef struct {
+    char rom[8];
+    uint8_t last_discrepancy;
+    uint8_t last_family_discrepancy;
+    bool last_device_flag;
+  } ds248x_search_t;
+
+  uint8_t _channel = 0;
+  bool _channel_known = false;  // the bridge is known to have _channel selected
+  uint8_t _enum_channel = 0;
+  bool _search_failed = false;  // the last search() ended by failure, not by the last device
+  ds248x_type_t _type = TypeUnknown;
+  ds248x_search_t _searches[DS248X_CHANNELS] = {};
+  ds248x_search_t _alarm_search = {};
+  ds248x_search_t _enum_search = {};
+  char _prefix[8] = {};
+  uint8_t _prefix_bits = 0;
+
+  char _resume_rom[DS248X_CHANNELS][8] = {};  // device with RC flag set on each channel
+  uint8_t _resume_valid = 0;                  // bit per channel
+  bool _rom_pending = false;                  // next byte written is ROM command
+
+  /**
+   * @brief Forget the device selected on current channel, the next select() uses Match ROM
+   *
+   */
+  void forgetSelected();
+
+  /**
+   * @brief Remember the device matched on current channel, if its family keeps
+   * the RC flag the next select() of it uses Resume
+   *
+   * @param rom unique address of the matched device
+   */
+  void rememberSelected(const char* rom);
+
+  /**
+   * @brief Store search state of current channel
+   *
+   */
+  void saveSearch();
+
+  /**
+   * @brief Restore search state of current channel
+   *
+   */
+  void loadSearch();
+
+  /**
+   * @brief Exchange search state with other one
+   *
+   * @param state state to load, gets the current one
+   */
+  void swapSearch(ds248x_search_t* state);
+
+  PlatformMutex _mutex;
+  uint8_t _session = 0;  // depth of sessions of the owning thread
+
+  /**
+   * @brief Lock the I2C bus unless a session holds it already
+   *
+   */
+  void busLock();
+
+  /**
+   * @brief Unlock the I2C bus unless a session holds it
+   *
+   */
+  void busUnlock();
+
+#if defined(MBED_CONF_DS248X_STATS)
+  ds248x_stats_t _stats = {};
 
   /**
-   * @brief Check for reset & short on the bus
+   * @brief Measures latency of public operation for its lifetime
+   *
+   */
+  class OpTimer {
+   public:
+    OpTimer(DS248X* parent, ds248x_op_t op);
+    ~OpTimer(void);
+
+   private:
+    DS248X* _parent;
+    ds248x_op_t _op;
+    microseconds _start;
+  };
+#endif
+
+  /**
+   * @brief Check for reset & short on the bus, when the bridge reset
+   * itself the requested config, channel and port are sent again
    *
    * @param status a pointer to the status data
+   * @return false if the bridge reset itself (the operation in progress is lost), otherwise true
+   */
+  bool checkError(char* status);
+
+  /**
+   * @brief Send the requested channel, port and config to a bridge
+   * which lost them, clears RST
+   *
+   * @param port port parameters to send (DS2484, if they were read or written)
+   * @return true if successful, otherwise false
+   */
+  bool restore(const ds248x_port_t* port);
+
+  /**
+   * @brief Wait with bounded exponential backoff and recover the bridge
+   * if the failed attempt was caused by a fault
+   *
+   * @param attempt number of the failed attempt, starting at 0
+   * @return true if the operation should be retried, otherwise false
+   */
+  bool retry(uint8_t attempt);
+
+  /**
+   * @brief Detect the device type by the read pointer codes it accepts,
+   * the channel register exists on DS2482-800 only, the port on DS2484 only
+   */
+  void detectType();
+
+  /**
+   * @brief Switch channel of DS2482-800 without touching the search state
+   *
+   * @param channel channel to switch to (0-7)
+   * @return true if successful, otherwise false
+   */
+  bool sendChannel(uint8_t channel);
+
+  /**
+   * @brief Derive expected reset and slot time from the port parameters
+   *
+   */
+  void updateTiming();
+
+  /**
+   * @brief Check that all devices pass verify() repeatedly
+   *
+   * @param devices devices to check
+   * @param count number of devices
+   * @param rounds number of rounds
+   * @return true if all passed, otherwise false
+   */
+  bool probePort(const ds248x_device_t* devices, size_t count, uint8_t rounds);
+
+  /**
+   * @brief Reset the bridge without touching the channel and search state
+   *
+   * @return true if successful, otherwise false
+   */
+  bool resetDevice();
+
+  /**
+   * @brief Queue event, dropped if the queue is full
+   *
+   * @param type event type
    */
-  void checkError(char* status);
+  void pushEvent(ds248x_event_type_t type);
 };
 
 #endif  // DS248X_H
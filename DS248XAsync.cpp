@@ -0,0 +1,310 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "DS248XAsync.h"
+
+DS248XAsync::DS248XAsync(DS248X *bridge) : _bridge(bridge) {}
+
+#if defined(__MBED__)
+DS248XAsync::DS248XAsync(DS248X *bridge, EventQueue *queue) : _bridge(bridge), _event_queue(queue) {}
+#endif
+
+bool DS248XAsync::submit(ds248x_request_t *request) {
+  MBED_ASSERT(request);
+
+  if (request->type != RequestReset && request->data == nullptr) {
+    tr_error("Request without buffer");
+    return false;
+  }
+
+  if ((request->type == RequestWrite || request->type == RequestRead) && request->len == 0) {
+    tr_error("Request without bytes");
+    return false;
+  }
+
+  if (_count >= MBED_CONF_DS248X_ASYNC_QUEUE_SIZE) {
+    tr_error("Request queue full");
+    return false;
+  }
+
+  _queue[(_head + _count) % MBED_CONF_DS248X_ASYNC_QUEUE_SIZE] = request;
+  _count++;
+
+#if defined(__MBED__)
+  if (_event_queue && !_scheduled) {
+    schedule(0us);
+  }
+#endif
+
+  return true;
+}
+
+bool DS248XAsync::busy() const {
+  return _current != nullptr || _count > 0;
+}
+
+microseconds DS248XAsync::process() {
+  DS248X::Session session(_bridge);
+  microseconds time;
+  char status;
+  bool success = false;
+
+  if (_state == StateIdle) {
+    if (_count == 0) {
+      return microseconds::max();
+    }
+
+    _current = _queue[_head];
+    _head = (_head + 1) % MBED_CONF_DS248X_ASYNC_QUEUE_SIZE;
+    _count--;
+
+    _index = 0;
+    _last_zero = 0;
+    _state = StateCommand;
+
+    if (_current->type == RequestSearch && _bridge->_last_device_flag) {
+      tr_warning("No more devices on the bus");
+      finish(false, 0);
+      return 0us;
+    }
+  }
+
+  if (_state == StateCommand) {
+    if (!command()) {
+      finish(false, 0);
+      return 0us;
+    }
+
+    _state = StatePoll;
+    _deadline = _bridge->_busy_until + microseconds(MBED_CONF_DS248X_BUSY_TIMEOUT);
+    time = now();
+
+    return (_bridge->_busy_until > time) ? (_bridge->_busy_until - time) : 0us;
+  }
+
+  // StatePoll
+  if (!_bridge->setReadPointer(DS248X::POINTER_STATUS) || !_bridge->deviceReadBytes(&status)) {
+    finish(false, 0);
+    return 0us;
+  }
+
+  if (status & DS248X_STATUS_1WB) {
+    if (now() < _deadline) {
+      return (_bridge->_config & DS248X_CONFIG_WS) ? DS248X_TIME_SLOT_OD : DS248X_TIME_SLOT;
+    }
+
+    tr_error("Device busy timeout");
+    _bridge->pushEvent(DS248X::EventBusyTimeout);
+
+    finish(false, status);
+    return 0us;
+  }
+
+  if (!_bridge->checkError(&status)) {
+    finish(false, status);
+    return 0us;
+  }
+
+  if (advance(status, &success)) {
+    finish(success, status);
+
+  } else {
+    _state = StateCommand;
+  }
+
+  return 0us;
+}
+
+microseconds DS248XAsync::now() const {
+  return _bridge->_bus->now();
+}
+
+bool DS248XAsync::command() {
+  char buf[2];
+  size_t len = 2;
+  bool spu = false;
+
+  switch (_current->type) {
+    case RequestReset:
+      if ((_bridge->_config & DS248X_CONFIG_SPU) && !_bridge->clearConfig(DS248X::StrongPullUp)) {
+        return false;
+      }
+
+      // devices expect ROM command now, the first byte written forgets the selected device
+      _bridge->_rom_pending = true;
+      buf[0] = (char)DS248X::CMD_1WRS;
+      len = 1;
+      break;
+
+    case RequestWrite:
+      // any ROM command clears RC flag of the last selected device, as in writeBytes()
+      if (_index == 0 && _bridge->_rom_pending) {
+        _bridge->_rom_pending = false;
+        _bridge->forgetSelected();
+      }
+
+      buf[0] = (char)DS248X::CMD_1WWB;
+      buf[1] = _current->data[_index];
+      spu = _current->spu && (_index == _current->len - 1);
+      break;
+
+    case RequestSelect:
+      // Match ROM moves RC flag to the new device, advance() remembers it when matched
+      if (_index == 0) {
+        _bridge->_rom_pending = false;
+        _bridge->forgetSelected();
+      }
+
+      buf[0] = (char)DS248X::CMD_1WWB;
+      buf[1] = (_index == 0) ? (char)DS248X::WIRE_COMMAND_SELECT : _current->data[_index - 1];
+      break;
+
+    case RequestRead:
+      buf[0] = (char)DS248X::CMD_1WRB;
+      len = 1;
+      spu = _current->spu && (_index == _current->len - 1);
+      break;
+
+    case RequestSearch:
+      if (_index == 0) {
+        _bridge->forgetSelected();
+        buf[0] = (char)DS248X::CMD_1WRS;
+        len = 1;
+
+      } else if (_index == 1) {
+        buf[0] = (char)DS248X::CMD_1WWB;
+        buf[1] = (char)DS248X::WIRE_COMMAND_SEARCH;
+
+      } else {
+        buf[0] = (char)DS248X::CMD_1WT;
+        buf[1] = _bridge->searchDirection(_index - 1) ? 0x80 : 0x00;
+      }
+
+      break;
+  }
+
+  if (spu && !(_bridge->_config & DS248X_CONFIG_SPU) && !_bridge->setConfig(DS248X::StrongPullUp)) {
+    return false;
+  }
+
+  return _bridge->deviceWriteBytes(buf, len);
+}
+
+bool DS248XAsync::advance(char status, bool *success) {
+  switch (_current->type) {
+    case RequestReset:
+      *success = status & DS248X_STATUS_PPD;
+      return true;
+
+    case RequestWrite:
+      *success = true;
+      return ++_index >= _current->len;
+
+    case RequestSelect:
+      *success = true;
+
+      if (++_index < 9) {
+        return false;
+      }
+
+      _bridge->rememberSelected(_current->data);
+      return true;
+
+    case RequestRead:
+      if (!_bridge->setReadPointer(DS248X::POINTER_DATA) || !_bridge->deviceReadBytes(&_current->data[_index])) {
+        *success = false;
+        return true;
+      }
+
+      *success = true;
+      return ++_index >= _current->len;
+
+    case RequestSearch:
+      if (_index == 0 && !(status & DS248X_STATUS_PPD)) {
+        tr_warning("No devices on the bus");
+        *success = false;
+        return true;
+      }
+
+      if (_index >= 2 && !_bridge->searchBit(_index - 1, status, &_last_zero)) {
+        _bridge->resetSearch();
+        *success = false;
+        return true;
+      }
+
+      if (++_index < 66) {
+        return false;
+      }
+
+      *success = _bridge->searchFinish(_last_zero, _current->data);
+      return true;
+  }
+
+  *success = false;
+  return true;
+}
+
+void DS248XAsync::finish(bool success, char status) {
+  ds248x_request_t *request = _current;
+
+  _current = nullptr;
+  _state = StateIdle;
+
+  request->success = success;
+  request->status = status;
+
+  if (request->done) {
+    request->done(request);
+  }
+}
+
+#if defined(__MBED__)
+void DS248XAsync::run() {
+  _scheduled = false;
+  schedule(process());
+}
+
+void DS248XAsync::wake() {
+  // called from interrupt, I2C must be accessed from the queue
+  if (_event_queue->call(callback(this, &DS248XAsync::run)) == 0) {
+    _scheduled = false;
+  }
+}
+
+void DS248XAsync::schedule(microseconds delay) {
+  if (delay == microseconds::max()) {
+    return;
+  }
+
+  _scheduled = true;
+
+  if (delay.count() > 0) {
+    _timeout.attach(callback(this, &DS248XAsync::wake), delay);
+
+  } else if (_event_queue->call(callback(this, &DS248XAsync::run)) == 0) {
+    tr_error("Event queue full");
+    _scheduled = false;
+  }
+}
+#endif
@@ -0,0 +1,151 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DS248X_ASYNC_H
+#define DS248X_ASYNC_H
+
+#include "DS248X.h"
+
+#if !defined(MBED_CONF_DS248X_ASYNC_QUEUE_SIZE)
+  #define MBED_CONF_DS248X_ASYNC_QUEUE_SIZE 8
+#endif
+
+/**
+ * @brief Non-blocking 1-Wire operations
+ *
+ * Requests are queued and advanced by a state machine, every step issues
+ * at most one command or status poll and never waits for the 1-Wire bus.
+ * All calls must come from the same context (ie. the EventQueue thread)
+ * and the blocking API of the bridge must not be used meanwhile.
+ */
+class DS248XAsync {
+ public:
+  typedef enum { RequestReset, RequestWrite, RequestRead, RequestSelect, RequestSearch } ds248x_request_type_t;
+
+  typedef struct ds248x_request_t {
+    ds248x_request_type_t type;
+    char* data;  // bytes to write, place for read bytes, ROM to select or place for found ROM
+    size_t len;
+    bool spu;  // strong pullup after the last byte
+    Callback<void(ds248x_request_t*)> done;
+
+    // result
+    bool success;  // reset: presence detected, search: device found
+    char status;   // last status register
+  } ds248x_request_t;
+
+  DS248XAsync(DS248X* bridge);
+#if defined(__MBED__)
+  /**
+   * @brief Create engine which schedules itself on the queue
+   *
+   * @param bridge bridge to drive
+   * @param queue event queue to run the steps from
+   */
+  DS248XAsync(DS248X* bridge, EventQueue* queue);
+#endif
+
+  /**
+   * @brief Queue request, the request must stay valid until done
+   *
+   * @param request request to process
+   * @return true if queued, false if queue full or the request has no buffer
+   * (or no bytes to write or read)
+   */
+  bool submit(ds248x_request_t* request);
+
+  /**
+   * @brief Whether any request is pending
+   *
+   * @return true if busy
+   */
+  bool busy() const;
+
+  /**
+   * @brief Advance the state machine by one step, called from the
+   * event queue or by the application when no queue is attached
+   *
+   * @return time after which to call again, microseconds::max() if idle
+   */
+  microseconds process();
+
+ private:
+  friend class DS248XScheduler;
+
+  typedef enum { StateIdle, StateCommand, StatePoll } state_t;
+
+  DS248X* _bridge;
+  ds248x_request_t* _queue[MBED_CONF_DS248X_ASYNC_QUEUE_SIZE];
+  uint8_t _head = 0;
+  uint8_t _count = 0;
+
+  ds248x_request_t* _current = nullptr;
+  state_t _state = StateIdle;
+  size_t _index = 0;
+  uint8_t _last_zero = 0;
+  microseconds _deadline = 0us;
+
+#if defined(__MBED__)
+  EventQueue* _event_queue = nullptr;
+  Timeout _timeout;
+  std::atomic<bool> _scheduled{false};  // cleared from wake() in interrupt
+
+  void run();
+  void wake();
+  void schedule(microseconds delay);
+#endif
+
+  /**
+   * @brief Get time of the bus the bridge is on
+   *
+   * @return time
+   */
+  microseconds now() const;
+
+  /**
+   * @brief Issue next command of current request
+   *
+   * @return true if successful, otherwise false
+   */
+  bool command();
+
+  /**
+   * @brief Process the status after command has finished
+   *
+   * @param status status register
+   * @param success place to put the result
+   * @return true if the request is finished
+   */
+  bool advance(char status, bool* success);
+
+  /**
+   * @brief Report current request and go idle
+   *
+   * @param success result
+   * @param status last status
+   */
+  void finish(bool success, char status);
+};
+
+#endif  // DS248X_ASYNC_H
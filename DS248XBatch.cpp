@@ -0,0 +1,73 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "DS248XBatch.h"
+
+DS248XBatch::DS248XBatch(DS248X *bridge, uint8_t channels) : _bridge(bridge), _channels(channels) {
+  MBED_ASSERT(channels > 0 && channels <= DS248X_CHANNELS);
+}
+
+size_t DS248XBatch::run(ds248x_batch_op_t *ops, size_t count) {
+  DS248X::Session session(_bridge);
+  uint8_t channels = (_channels < _bridge->channelCount()) ? _channels : _bridge->channelCount();
+  uint8_t first = _bridge->getChannel() % channels;
+  uint8_t channel;
+  bool selected;
+  size_t done = 0;
+
+  MBED_ASSERT(ops || count == 0);
+
+  for (size_t i = 0; i < count; i++) {
+    ops[i].success = false;
+  }
+
+  // the selected channel goes first, it costs no channel select
+  for (uint8_t n = 0; n < channels; n++) {
+    channel = (first + n) % channels;
+    selected = false;
+
+    for (size_t i = 0; i < count; i++) {
+      if (ops[i].device->channel != channel) {
+        continue;
+      }
+
+      if (!selected) {
+        if (!_bridge->selectChannel(channel)) {
+          tr_error("Skipping channel %u", channel);
+          break;
+        }
+
+        selected = true;
+      }
+
+      ops[i].success = ops[i].operation(_bridge, ops[i].device);
+
+      if (ops[i].success) {
+        done++;
+      }
+    }
+  }
+
+  return done;
+}
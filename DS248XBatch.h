@@ -0,0 +1,69 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DS248X_BATCH_H
+#define DS248X_BATCH_H
+
+#include "DS248X.h"
+
+/**
+ * @brief Runs operations on devices scattered over channels of DS2482-800
+ *
+ * Operations are grouped by channel, starting with the selected one, so
+ * each channel is selected once per run. Within a channel they keep
+ * their order. The whole run is a single session.
+ */
+class DS248XBatch {
+ public:
+  typedef struct {
+    const DS248X::ds248x_device_t* device;
+    Callback<bool(DS248X*, const DS248X::ds248x_device_t*)> operation;  // called with the channel selected
+
+    // result
+    bool success;
+  } ds248x_batch_op_t;
+
+  /**
+   * @brief Create batch runner
+   *
+   * @param bridge bridge to use
+   * @param channels number of channels, limited to the channels of the bridge
+   */
+  DS248XBatch(DS248X* bridge, uint8_t channels = DS248X_CHANNELS);
+
+  /**
+   * @brief Run the operations ordered by channel
+   *
+   * @param ops operations, success gets updated
+   * @param count number of operations
+   * @return number of successful operations
+   */
+  size_t run(ds248x_batch_op_t* ops, size_t count);
+
+ private:
+  DS248X* _bridge;
+  uint8_t _channels;
+};
+
+#endif  // DS248X_BATCH_H
@@ -0,0 +1,77 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "DS248XCRC.h"
+
+constexpr DS248XCRC::table8_t DS248XCRC::makeTable8() {
+  table8_t table = {};
+
+  for (uint16_t i = 0; i < 256; i++) {
+    uint8_t crc = i;
+
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0x8C : (crc >> 1);
+    }
+
+    table.value[i] = crc;
+  }
+
+  return table;
+}
+
+constexpr DS248XCRC::table16_t DS248XCRC::makeTable16() {
+  table16_t table = {};
+
+  for (uint16_t i = 0; i < 256; i++) {
+    uint16_t crc = i;
+
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+    }
+
+    table.value[i] = crc;
+  }
+
+  return table;
+}
+
+// generated by the compiler, the tables end up in flash
+const DS248XCRC::table8_t DS248XCRC::_table8 = makeTable8();
+const DS248XCRC::table16_t DS248XCRC::_table16 = makeTable16();
+
+uint8_t DS248XCRC::crc8(const char *data, size_t len, uint8_t crc) {
+  for (size_t i = 0; i < len; i++) {
+    crc = update8(crc, data[i]);
+  }
+
+  return crc;
+}
+
+uint16_t DS248XCRC::crc16(const char *data, size_t len, uint16_t crc) {
+  for (size_t i = 0; i < len; i++) {
+    crc = update16(crc, data[i]);
+  }
+
+  return crc;
+}
@@ -0,0 +1,101 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DS248X_CRC_H
+#define DS248X_CRC_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define DS248X_CRC16_RESIDUE 0xB001  // CRC16 over data followed by its inverted CRC16
+
+/**
+ * @brief Table driven 1-Wire CRC8 (X^8 + X^5 + X^4 + 1) and CRC16 (X^16 + X^15 + X^2 + 1)
+ *
+ * Both are reflected, start at 0 and can be updated byte by byte.
+ * Running CRC8 over data followed by its CRC is 0, running CRC16 over
+ * data followed by its inverted CRC16 (as memory devices send it) is
+ * DS248X_CRC16_RESIDUE.
+ */
+class DS248XCRC {
+ public:
+  /**
+   * @brief Fold byte into CRC8
+   *
+   * @param crc running CRC
+   * @param data byte
+   * @return new CRC
+   */
+  static uint8_t update8(uint8_t crc, char data) {
+    return _table8.value[crc ^ static_cast<uint8_t>(data)];
+  }
+
+  /**
+   * @brief Compute CRC8 of data block
+   *
+   * @param data a pointer to the data block
+   * @param len the size of the data
+   * @param crc running CRC to continue from
+   * @return CRC
+   */
+  static uint8_t crc8(const char* data, size_t len, uint8_t crc = 0);
+
+  /**
+   * @brief Fold byte into CRC16
+   *
+   * @param crc running CRC
+   * @param data byte
+   * @return new CRC
+   */
+  static uint16_t update16(uint16_t crc, char data) {
+    return (crc >> 8) ^ _table16.value[(crc ^ static_cast<uint8_t>(data)) & 0xFF];
+  }
+
+  /**
+   * @brief Compute CRC16 of data block
+   *
+   * @param data a pointer to the data block
+   * @param len the size of the data
+   * @param crc running CRC to continue from
+   * @return CRC
+   */
+  static uint16_t crc16(const char* data, size_t len, uint16_t crc = 0);
+
+ private:
+  typedef struct {
+    uint8_t value[256];
+  } table8_t;
+
+  typedef struct {
+    uint16_t value[256];
+  } table16_t;
+
+  static const table8_t _table8;
+  static const table16_t _table16;
+
+  static constexpr table8_t makeTable8();
+  static constexpr table16_t makeTable16();
+};
+
+#endif  // DS248X_CRC_H
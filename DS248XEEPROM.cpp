@@ -0,0 +1,299 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "DS248XEEPROM.h"
+
+#define DS248X_EEPROM_PAGE 32
+#define DS248X_EEPROM_COPY_SUCCESS 0xAA
+
+DS248XEEPROM::DS248XEEPROM(DS248X *bridge, const char *rom) : _bridge(bridge) {
+  memcpy(_rom, rom, sizeof(_rom));
+
+  switch (static_cast<uint8_t>(rom[0])) {
+    case DS248X_FAMILY_DS2431:
+      _size = 128;
+      _end = 0x90;
+      _row = 8;
+      break;
+
+    case DS248X_FAMILY_DS28EC20:
+      _size = 2560;
+      _end = 0xA20;
+      _row = 32;
+      break;
+
+    default:
+      tr_error("Unsupported family: %02X", rom[0]);
+      break;
+  }
+}
+
+bool DS248XEEPROM::begin() {
+  if (_row == 0) {
+    return false;
+  }
+
+  return _bridge->reset() && _bridge->select(_rom);
+}
+
+bool DS248XEEPROM::read(uint16_t address, char *buffer, size_t len) {
+  DS248X::Session session(_bridge);
+  char buf[DS248X_EEPROM_PAGE];
+  bool extended = (_rom[0] == DS248X_FAMILY_DS28EC20);
+  uint16_t crc;
+  size_t page_left;
+  size_t n;
+
+  if (buffer == nullptr || len == 0 || address + len > _end) {
+    tr_error("Invalid input data");
+    return false;
+  }
+
+  if (!begin()) {
+    return false;
+  }
+
+  buf[0] = extended ? (char)COMMAND_EXTENDED_READ_MEMORY : (char)COMMAND_READ_MEMORY;
+  buf[1] = address & 0xFF;
+  buf[2] = address >> 8;
+
+  if (!_bridge->writeBytes(buf, 3)) {
+    return false;
+  }
+
+  // device streams to the end of memory, only the requested part is clocked out
+  if (!extended) {
+    return _bridge->readBytes(buffer, len) && _bridge->reset();
+  }
+
+  crc = DS248XCRC::crc16(buf, 3);
+
+  while (len > 0) {
+    page_left = DS248X_EEPROM_PAGE - (address % DS248X_EEPROM_PAGE);
+    n = (len < page_left) ? len : page_left;
+
+    if (!_bridge->readBytes(buffer, n, &crc)) {
+      return false;
+    }
+
+    // rest of the last page is needed for the CRC
+    if (n < page_left && !_bridge->readBytes(buf, page_left - n, &crc)) {
+      return false;
+    }
+
+    if (!_bridge->readBytes(buf, 2, &crc)) {
+      return false;
+    }
+
+    if (crc != DS248X_CRC16_RESIDUE) {
+      tr_error("Page %u CRC failed", address / DS248X_EEPROM_PAGE);
+      _bridge->crcFailed();
+      _bridge->reset();
+      return false;
+    }
+
+    // next page CRC covers just the data
+    crc = 0;
+    address += page_left;
+    buffer += n;
+    len -= n;
+  }
+
+  return _bridge->reset();
+}
+
+bool DS248XEEPROM::write(uint16_t address, const char *data, size_t len) {
+  DS248X::Session session(_bridge);
+  char row[DS248X_EEPROM_PAGE];
+  const char *source;
+  uint16_t row_address;
+  uint16_t target;
+  uint8_t es;
+  size_t offset;
+  size_t scratchpad_len;
+  size_t n;
+
+  if (data == nullptr || len == 0 || _row == 0 || address + len > _end) {
+    tr_error("Invalid input data");
+    return false;
+  }
+
+  while (len > 0) {
+    row_address = address - (address % _row);
+    offset = address - row_address;
+    n = (len < _row - offset) ? len : _row - offset;
+
+    // partial row, the rest must be kept
+    if (n < _row) {
+      if (!read(row_address, row, _row)) {
+        return false;
+      }
+
+      memcpy(&row[offset], data, n);
+      source = row;
+
+    } else {
+      source = data;
+    }
+
+    if (!writeScratchpad(row_address, source, _row)) {
+      return false;
+    }
+
+    // full row was accepted (CRC matched), so the authorization is known
+    if (!copyScratchpad(row_address, _row - 1)) {
+      tr_warning("Copy failed, reading authorization");
+
+      if (!readScratchpad(&target, &es, row, &scratchpad_len) || !copyScratchpad(target, es)) {
+        return false;
+      }
+    }
+
+    address += n;
+    data += n;
+    len -= n;
+  }
+
+  return true;
+}
+
+bool DS248XEEPROM::writeScratchpad(uint16_t address, const char *data, size_t len) {
+  DS248X::Session session(_bridge);
+  char buf[3 + DS248X_EEPROM_PAGE];
+  uint16_t crc;
+  size_t offset = (_row > 0) ? address % _row : 0;
+
+  if (data == nullptr || len == 0 || offset + len > _row) {
+    tr_error("Invalid input data");
+    return false;
+  }
+
+  if (!begin()) {
+    return false;
+  }
+
+  buf[0] = (char)COMMAND_WRITE_SCRATCHPAD;
+  buf[1] = address & 0xFF;
+  buf[2] = address >> 8;
+  memcpy(&buf[3], data, len);
+
+  if (!_bridge->writeBytes(buf, 3 + len)) {
+    return false;
+  }
+
+  // device sends CRC only when the scratchpad is filled up to the end
+  if (offset + len < _row) {
+    return true;
+  }
+
+  crc = DS248XCRC::crc16(buf, 3 + len);
+
+  if (!_bridge->readBytes(buf, 2, &crc)) {
+    return false;
+  }
+
+  if (crc != DS248X_CRC16_RESIDUE) {
+    tr_error("Write scratchpad CRC failed");
+    _bridge->crcFailed();
+    return false;
+  }
+
+  return true;
+}
+
+bool DS248XEEPROM::readScratchpad(uint16_t *address, uint8_t *es, char *data, size_t *len) {
+  DS248X::Session session(_bridge);
+  char buf[3];
+  uint16_t crc;
+  size_t offset;
+  size_t end;
+
+  if (!begin() || !_bridge->write(COMMAND_READ_SCRATCHPAD)) {
+    return false;
+  }
+
+  crc = DS248XCRC::update16(0, (char)COMMAND_READ_SCRATCHPAD);
+
+  if (!_bridge->readBytes(buf, 3, &crc)) {
+    return false;
+  }
+
+  *address = static_cast<uint8_t>(buf[0]) | (static_cast<uint8_t>(buf[1]) << 8);
+  *es = buf[2];
+
+  offset = *address % _row;
+  end = *es & (_row - 1);
+
+  if (end < offset) {
+    tr_error("Invalid scratchpad state");
+    return false;
+  }
+
+  *len = end - offset + 1;
+
+  if (!_bridge->readBytes(data, *len, &crc) || !_bridge->readBytes(buf, 2, &crc)) {
+    return false;
+  }
+
+  if (crc != DS248X_CRC16_RESIDUE) {
+    tr_error("Read scratchpad CRC failed");
+    _bridge->crcFailed();
+    return false;
+  }
+
+  return true;
+}
+
+bool DS248XEEPROM::copyScratchpad(uint16_t address, uint8_t es) {
+  // nobody may end the strong pullup during programming
+  DS248X::Session session(_bridge);
+  char buf[4];
+
+  if (!begin()) {
+    return false;
+  }
+
+  buf[0] = (char)COMMAND_COPY_SCRATCHPAD;
+  buf[1] = address & 0xFF;
+  buf[2] = address >> 8;
+  buf[3] = es;
+
+  // strong pullup follows the E/S byte and powers the programming
+  if (!_bridge->writePowered(buf, sizeof(buf), DS248X_TIME_PROGRAM)) {
+    return false;
+  }
+
+  if (!_bridge->read(buf)) {
+    return false;
+  }
+
+  _bridge->reset();
+
+  if (static_cast<uint8_t>(buf[0]) != DS248X_EEPROM_COPY_SUCCESS) {
+    tr_error("Copy scratchpad failed");
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,136 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DS248X_EEPROM_H
+#define DS248X_EEPROM_H
+
+#include "DS248X.h"
+
+#define DS248X_FAMILY_DS2431 0x2D
+#define DS248X_FAMILY_DS28EC20 0x43
+
+#define DS248X_TIME_PROGRAM 10ms  // copy scratchpad programming time
+
+/**
+ * @brief DS2431 / DS28EC20 EEPROM
+ *
+ * Memory is written by whole scratchpad rows (8 bytes on DS2431, 32 bytes
+ * on DS28EC20), partial rows are read and merged first. Every row gets
+ * verified by the CRC16 the device returns after Write Scratchpad.
+ * DS28EC20 reads use Extended Read Memory with CRC16 after every page,
+ * DS2431 has no CRC on Read Memory.
+ */
+class DS248XEEPROM {
+ public:
+  /**
+   * @brief Create driver for device
+   *
+   * @param bridge bridge the device is behind (channel must be selected)
+   * @param rom unique address of device, family code selects the type
+   */
+  DS248XEEPROM(DS248X* bridge, const char* rom);
+
+  /**
+   * @brief Get size of the user memory
+   *
+   * @return size in bytes, 0 if the device is not supported
+   */
+  size_t size() const {
+    return _size;
+  }
+
+  /**
+   * @brief Read memory straight into the buffer, DS28EC20 pages are verified by CRC16
+   *
+   * @param address memory address
+   * @param buffer place to put the reading
+   * @param len size of data to read
+   * @return true if successful, otherwise false
+   */
+  bool read(uint16_t address, char* buffer, size_t len);
+
+  /**
+   * @brief Write memory row by row, each row is verified and programmed
+   *
+   * @param address memory address
+   * @param data a pointer to the data block
+   * @param len the size of the data to be written
+   * @return true if successful, otherwise false
+   */
+  bool write(uint16_t address, const char* data, size_t len);
+
+  /**
+   * @brief Write Scratchpad, CRC16 is verified if the data end at the end of the scratchpad
+   *
+   * @param address target address
+   * @param data a pointer to the data block
+   * @param len the size of the data, up to the end of the scratchpad
+   * @return true if successful, otherwise false
+   */
+  bool writeScratchpad(uint16_t address, const char* data, size_t len);
+
+  /**
+   * @brief Read Scratchpad, verified by CRC16
+   *
+   * @param address place to put the target address
+   * @param es place to put the ending offset and status byte
+   * @param data place to put the data (scratchpad size)
+   * @param len place to put the size of the data
+   * @return true if successful, otherwise false
+   */
+  bool readScratchpad(uint16_t* address, uint8_t* es, char* data, size_t* len);
+
+  /**
+   * @brief Copy Scratchpad, strong pullup is held for the programming time
+   *
+   * @param address target address as returned by Read Scratchpad
+   * @param es ending offset and status byte as returned by Read Scratchpad
+   * @return true if successful, otherwise false
+   */
+  bool copyScratchpad(uint16_t address, uint8_t es);
+
+ private:
+  typedef enum {
+    COMMAND_WRITE_SCRATCHPAD = 0x0F,
+    COMMAND_COPY_SCRATCHPAD = 0x55,
+    COMMAND_EXTENDED_READ_MEMORY = 0xA5,
+    COMMAND_READ_SCRATCHPAD = 0xAA,
+    COMMAND_READ_MEMORY = 0xF0,
+  } ds248x_eeprom_cmd_t;
+
+  DS248X* _bridge;
+  char _rom[8];
+  size_t _size = 0;
+  uint16_t _end = 0;  // including registers
+  uint8_t _row = 0;   // scratchpad size
+
+  /**
+   * @brief Reset the bus and select the device
+   *
+   * @return true if successful, otherwise false
+   */
+  bool begin();
+};
+
+#endif  // DS248X_EEPROM_H
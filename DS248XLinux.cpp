@@ -0,0 +1,201 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "DS248XLinux.h"
+
+#if defined(__linux__) && !defined(__MBED__)
+  #include <fcntl.h>
+  #include <linux/i2c-dev.h>
+  #include <sys/ioctl.h>
+  #include <time.h>
+  #include <unistd.h>
+
+DS248XLinuxTransport::DS248XLinuxTransport(uint32_t frequency) {
+  if (frequency == 0) {
+    tr_warning("No I2C clock given, assuming %u Hz", DS248X_LINUX_FREQUENCY);
+    frequency = DS248X_LINUX_FREQUENCY;
+  }
+
+  // restart, address + ACK, the byte is sampled afterwards
+  _read_time = std::chrono::microseconds(10 * 1000000 / frequency);
+}
+
+DS248XLinuxTransport::~DS248XLinuxTransport(void) {
+  close();
+}
+
+bool DS248XLinuxTransport::open(const char *device) {
+  close();
+
+  _fd = ::open(device, O_RDWR);
+
+  if (_fd < 0) {
+    tr_error("Can't open %s", device);
+    return false;
+  }
+
+  return true;
+}
+
+void DS248XLinuxTransport::close() {
+  if (_fd >= 0) {
+    ::close(_fd);
+    _fd = -1;
+  }
+}
+
+void DS248XLinuxTransport::lock() {
+  _mutex.lock();
+}
+
+void DS248XLinuxTransport::unlock() {
+  _mutex.unlock();
+}
+
+int DS248XLinuxTransport::write(int address, const char *data, int length, bool repeated) {
+  int error;
+
+  if (length < 0 || length > DS248X_LINUX_BUFFER) {
+    return -1;
+  }
+
+  // make room, the previous messages go as separate transfer and their NACK fails this write
+  if (_count == DS248X_LINUX_MESSAGES || _used + length > DS248X_LINUX_BUFFER) {
+    error = flush();
+
+    if (error != 0) {
+      return error;
+    }
+  }
+
+  memcpy(&_buffer[_used], data, length);
+
+  _messages[_count].addr = address >> 1;
+  _messages[_count].flags = 0;
+  _messages[_count].len = length;
+  _messages[_count].buf = &_buffer[_used];
+  _count++;
+  _used += length;
+
+  if (repeated) {
+    return 0;
+  }
+
+  return flush();
+}
+
+int DS248XLinuxTransport::read(int address, char *data, int length, bool repeated) {
+  int error;
+
+  (void)repeated;
+
+  if (length < 0) {
+    return -1;
+  }
+
+  if (_count == DS248X_LINUX_MESSAGES) {
+    error = flush();
+
+    if (error != 0) {
+      return error;
+    }
+  }
+
+  // straight to the caller buffer, it is sent right now
+  _messages[_count].addr = address >> 1;
+  _messages[_count].flags = I2C_M_RD;
+  _messages[_count].len = length;
+  _messages[_count].buf = reinterpret_cast<uint8_t *>(data);
+  _count++;
+
+  return flush();
+}
+
+int DS248XLinuxTransport::stop() {
+  return flush();
+}
+
+bool DS248XLinuxTransport::hold(std::chrono::microseconds time) {
+  return time <= _read_time;
+}
+
+std::chrono::microseconds DS248XLinuxTransport::now() {
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  return std::chrono::seconds(time.tv_sec) + std::chrono::microseconds(time.tv_nsec / 1000);
+}
+
+void DS248XLinuxTransport::wait(std::chrono::microseconds time) {
+  // transaction kept by hold(), addressing the bridge for the status takes longer than the activity
+  if (_count > 0) {
+    return;
+  }
+
+  if (time.count() > 0) {
+    sleep(time);
+  }
+}
+
+int DS248XLinuxTransport::transfer(struct i2c_msg *messages, size_t count) {
+  struct i2c_rdwr_ioctl_data data;
+
+  data.msgs = messages;
+  data.nmsgs = count;
+
+  return ioctl(_fd, I2C_RDWR, &data);
+}
+
+void DS248XLinuxTransport::sleep(std::chrono::microseconds time) {
+  struct timespec delay;
+
+  delay.tv_sec = time.count() / 1000000;
+  delay.tv_nsec = (time.count() % 1000000) * 1000;
+
+  clock_nanosleep(CLOCK_MONOTONIC, 0, &delay, nullptr);
+}
+
+int DS248XLinuxTransport::flush() {
+  int error = 0;
+  int result;
+
+  if (_count == 0) {
+    return 0;
+  }
+
+  result = transfer(_messages, _count);
+  _transfers++;
+
+  if (result < 0 || static_cast<size_t>(result) != _count) {
+    tr_error("Transfer failed");
+    error = -1;
+  }
+
+  _count = 0;
+  _used = 0;
+
+  return error;
+}
+#endif
@@ -0,0 +1,126 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DS248X_LINUX_H
+#define DS248X_LINUX_H
+
+#include "DS248X.h"
+
+#if defined(__linux__) && !defined(__MBED__)
+  #include <linux/i2c.h>
+
+  #define DS248X_LINUX_MESSAGES 8        // queued I2C messages, one transfer
+  #define DS248X_LINUX_BUFFER 32         // bytes of queued writes
+  #define DS248X_LINUX_FREQUENCY 100000  // I2C clock [Hz] assumed when none is given
+
+/**
+ * @brief Transport over Linux i2c-dev (/dev/i2c-N)
+ *
+ * Writes which keep the transaction open are queued and sent together
+ * with the next read as one I2C_RDWR transfer (one syscall, repeated
+ * starts, one STOP), ie. SRP + data read, or 1-Wire command + status read
+ * when the command takes less than addressing the bridge for the read
+ * (hold()). Before longer activity the driver sends the command alone by
+ * stop(), so the bus is free meanwhile. A NACK of a queued write is
+ * reported by the read, write or stop() which sends it.
+ */
+class DS248XLinuxTransport : public DS248XTransport {
+ public:
+  /**
+   * @brief Create transport
+   *
+   * @param frequency I2C bus clock the adapter runs at [Hz], 0 for DS248X_LINUX_FREQUENCY
+   */
+  DS248XLinuxTransport(uint32_t frequency = DS248X_LINUX_FREQUENCY);
+  virtual ~DS248XLinuxTransport(void);
+
+  /**
+   * @brief Open the adapter
+   *
+   * @param device path of the adapter (ie. "/dev/i2c-1")
+   * @return true if successful, otherwise false
+   */
+  bool open(const char* device);
+
+  /**
+   * @brief Close the adapter
+   *
+   */
+  void close();
+
+  /**
+   * @brief Number of I2C_RDWR transfers issued
+   *
+   * @return count
+   */
+  uint32_t transfers() const {
+    return _transfers;
+  }
+
+  virtual void lock() override;
+  virtual void unlock() override;
+  virtual int write(int address, const char* data, int length, bool repeated = false) override;
+  virtual int read(int address, char* data, int length, bool repeated = false) override;
+  virtual int stop() override;
+  virtual bool hold(std::chrono::microseconds time) override;
+  virtual std::chrono::microseconds now() override;
+  virtual void wait(std::chrono::microseconds time) override;
+
+ protected:
+  /**
+   * @brief Issue combined transfer, override to talk to a stand-in of the bridge
+   *
+   * @param messages messages with repeated start in between
+   * @param count number of messages
+   * @return number of messages transferred, negative on error
+   */
+  virtual int transfer(struct i2c_msg* messages, size_t count);
+
+  /**
+   * @brief Sleep, override together with now() to run on simulated time
+   *
+   * @param time how long to sleep
+   */
+  virtual void sleep(std::chrono::microseconds time);
+
+ private:
+  int _fd = -1;
+  PlatformMutex _mutex;
+  std::chrono::microseconds _read_time;  // from restart until the bridge samples the byte to send
+  struct i2c_msg _messages[DS248X_LINUX_MESSAGES];
+  size_t _count = 0;
+  uint8_t _buffer[DS248X_LINUX_BUFFER];
+  size_t _used = 0;
+  uint32_t _transfers = 0;
+
+  /**
+   * @brief Send queued messages
+   *
+   * @return 0 on ACK, non-zero on NACK
+   */
+  int flush();
+};
+#endif
+
+#endif  // DS248X_LINUX_H
@@ -0,0 +1,322 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "DS248XRegistry.h"
+
+#include <cstddef>
+
+#if defined(DS248X_REGISTRY_STORAGE)
+  #if defined(__MBED__)
+    #include "kvstore_global_api.h"
+  #else
+    #include <cstdio>
+  #endif
+#endif
+
+DS248XRegistry::DS248XRegistry() {
+  _store.magic = DS248X_REGISTRY_MAGIC;
+  reindex();
+}
+
+bool DS248XRegistry::add(const char *rom, uint8_t bridge, uint8_t channel, uint32_t seen) {
+  size_t i = slot(rom);
+  ds248x_entry_t *entry;
+
+  if (_slots[i] == UINT16_MAX) {
+    if (_store.count >= MBED_CONF_DS248X_REGISTRY_SIZE) {
+      tr_error("Registry full");
+      return false;
+    }
+
+    _slots[i] = _store.count;
+    entry = &_store.entries[_store.count++];
+    memcpy(entry->rom, rom, sizeof(entry->rom));
+    entry->reserved = 0;
+
+  } else {
+    entry = &_store.entries[_slots[i]];
+  }
+
+  // device may have moved
+  entry->bridge = bridge;
+  entry->channel = channel;
+  entry->last_seen = seen;
+
+  return true;
+}
+
+DS248XRegistry::ds248x_entry_t *DS248XRegistry::find(const char *rom) {
+  size_t i = slot(rom);
+
+  return (_slots[i] == UINT16_MAX) ? nullptr : &_store.entries[_slots[i]];
+}
+
+size_t DS248XRegistry::prune(uint32_t since) {
+  size_t kept = 0;
+  size_t removed;
+
+  for (size_t i = 0; i < _store.count; i++) {
+    if (_store.entries[i].last_seen >= since) {
+      _store.entries[kept++] = _store.entries[i];
+    }
+  }
+
+  removed = _store.count - kept;
+  _store.count = kept;
+  reindex();
+
+  return removed;
+}
+
+void DS248XRegistry::clear() {
+  _store.count = 0;
+  reindex();
+}
+
+size_t DS248XRegistry::start(DS248X *bridge, uint8_t index, uint32_t now, bool *searched, uint8_t channels) {
+  size_t stored = 0;
+  size_t present;
+  bool search;
+
+  if (channels > bridge->channelCount()) {
+    channels = bridge->channelCount();
+  }
+
+  // devices on channels which are not checked can't be confirmed
+  for (size_t i = 0; i < _store.count; i++) {
+    if (_store.entries[i].bridge == index && _store.entries[i].channel < channels) {
+      stored++;
+    }
+  }
+
+  present = confirm(bridge, index, now, channels);
+  search = (stored == 0 || present != stored);
+
+  if (searched) {
+    *searched = search;
+  }
+
+  if (!search) {
+    tr_info("All %u devices confirmed", present);
+    return present;
+  }
+
+  tr_info("%u of %u devices confirmed, enumerating", present, stored);
+  return scan(bridge, index, now, channels);
+}
+
+size_t DS248XRegistry::confirm(DS248X *bridge, uint8_t index, uint32_t now, uint8_t channels) {
+  DS248X::Session session(bridge);
+  ds248x_entry_t *entry;
+  size_t present = 0;
+  size_t stored;
+
+  if (channels > bridge->channelCount()) {
+    channels = bridge->channelCount();
+  }
+
+  for (uint8_t channel = 0; channel < channels; channel++) {
+    stored = 0;
+
+    for (size_t i = 0; i < _store.count; i++) {
+      if (_store.entries[i].bridge == index && _store.entries[i].channel == channel) {
+        stored++;
+      }
+    }
+
+    // select channel only if there is something to confirm
+    if (stored == 0 || !bridge->selectChannel(channel)) {
+      continue;
+    }
+
+    for (size_t i = 0; i < _store.count; i++) {
+      entry = &_store.entries[i];
+
+      if (entry->bridge == index && entry->channel == channel && check(bridge, entry->rom, stored == 1)) {
+        entry->last_seen = now;
+        present++;
+      }
+    }
+  }
+
+  return present;
+}
+
+size_t DS248XRegistry::scan(DS248X *bridge, uint8_t index, uint32_t now, uint8_t channels) {
+  DS248X::Session session(bridge);
+  DS248X::ds248x_device_t devices[8];
+  size_t found = 0;
+  size_t count;
+  DS248X::ds248x_enum_result_t result;
+
+  bridge->resetEnumeration();
+
+  do {
+    result = bridge->enumerateAll(devices, sizeof(devices) / sizeof(devices[0]), &count, nullptr, channels);
+
+    for (size_t i = 0; i < count; i++) {
+      if (add(devices[i].rom, index, devices[i].channel, now)) {
+        found++;
+      }
+    }
+  } while (result == DS248X::EnumFull);
+
+  return found;
+}
+
+const char *DS248XRegistry::serialize(size_t *len) {
+  _store.crc = DS248XCRC::crc16(reinterpret_cast<const char *>(_store.entries), _store.count * sizeof(ds248x_entry_t));
+  *len = blobSize();
+
+  return reinterpret_cast<const char *>(&_store);
+}
+
+bool DS248XRegistry::deserialize(const char *data, size_t len) {
+  const size_t header = offsetof(registry_t, entries);
+  uint32_t magic;
+  uint16_t count;
+  uint16_t crc;
+
+  if (data == nullptr || len < header) {
+    return false;
+  }
+
+  // blob may be unaligned
+  memcpy(&magic, data + offsetof(registry_t, magic), sizeof(magic));
+  memcpy(&count, data + offsetof(registry_t, count), sizeof(count));
+  memcpy(&crc, data + offsetof(registry_t, crc), sizeof(crc));
+
+  if (magic != DS248X_REGISTRY_MAGIC || count > MBED_CONF_DS248X_REGISTRY_SIZE ||
+      len != header + count * sizeof(ds248x_entry_t)) {
+    tr_error("Invalid registry");
+    return false;
+  }
+
+  if (DS248XCRC::crc16(data + header, count * sizeof(ds248x_entry_t)) != crc) {
+    tr_error("Registry CRC failed");
+    return false;
+  }
+
+  if (data != reinterpret_cast<const char *>(&_store)) {
+    memcpy(&_store, data, len);
+  }
+
+  reindex();
+  return true;
+}
+
+#if defined(DS248X_REGISTRY_STORAGE)
+bool DS248XRegistry::save(const char *key) {
+  size_t len;
+  const char *data = serialize(&len);
+
+  #if defined(__MBED__)
+  return kv_set(key, data, len, 0) == MBED_SUCCESS;
+  #else
+  FILE *file = fopen(key, "wb");
+  bool success;
+
+  if (file == nullptr) {
+    return false;
+  }
+
+  success = (fwrite(data, 1, len, file) == len);
+  return (fclose(file) == 0) && success;
+  #endif
+}
+
+bool DS248XRegistry::load(const char *key) {
+  size_t len = 0;
+
+  // read in place, the registry is empty if it's not valid
+  #if defined(__MBED__)
+  if (kv_get(key, &_store, sizeof(_store), &len) != MBED_SUCCESS) {
+    len = 0;
+  }
+  #else
+  FILE *file = fopen(key, "rb");
+
+  if (file != nullptr) {
+    len = fread(&_store, 1, sizeof(_store), file);
+    fclose(file);
+  }
+  #endif
+
+  if (!deserialize(reinterpret_cast<const char *>(&_store), len)) {
+    _store.magic = DS248X_REGISTRY_MAGIC;
+    clear();
+    return false;
+  }
+
+  return true;
+}
+#endif
+
+bool DS248XRegistry::check(DS248X *bridge, const char *rom, bool alone) {
+  char buf[8];
+
+  if (!alone) {
+    return bridge->verify(rom);
+  }
+
+  // single device answers Read ROM, an added one corrupts it
+  buf[0] = ROM_READ;
+
+  if (!bridge->reset() || !bridge->writeBytes(buf, 1) || !bridge->readBytes(buf, sizeof(buf))) {
+    return false;
+  }
+
+  return memcmp(buf, rom, sizeof(buf)) == 0;
+}
+
+size_t DS248XRegistry::slot(const char *rom) const {
+  uint32_t hash = 2166136261UL;
+  size_t i;
+
+  // FNV-1a
+  for (i = 0; i < 8; i++) {
+    hash = (hash ^ static_cast<uint8_t>(rom[i])) * 16777619UL;
+  }
+
+  // open addressing, the table is at most half full
+  i = hash % DS248X_REGISTRY_SLOTS;
+
+  while (_slots[i] != UINT16_MAX && memcmp(_store.entries[_slots[i]].rom, rom, 8) != 0) {
+    i = (i + 1) % DS248X_REGISTRY_SLOTS;
+  }
+
+  return i;
+}
+
+void DS248XRegistry::reindex() {
+  memset(_slots, 0xFF, sizeof(_slots));
+
+  for (size_t i = 0; i < _store.count; i++) {
+    _slots[slot(_store.entries[i].rom)] = i;
+  }
+}
+
+size_t DS248XRegistry::blobSize() const {
+  return offsetof(registry_t, entries) + _store.count * sizeof(ds248x_entry_t);
+}
@@ -0,0 +1,238 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DS248X_REGISTRY_H
+#define DS248X_REGISTRY_H
+
+#include "DS248X.h"
+
+#if !defined(MBED_CONF_DS248X_REGISTRY_SIZE)
+  #define MBED_CONF_DS248X_REGISTRY_SIZE 64
+#endif
+
+#if MBED_CONF_DS248X_REGISTRY_SIZE > 32767
+  #error "ds248x.registry_size must be at most 32767"
+#endif
+
+#define DS248X_REGISTRY_SLOTS (2 * MBED_CONF_DS248X_REGISTRY_SIZE)  // hash table is kept at most half full
+#define DS248X_REGISTRY_MAGIC 0x52383444                            // "D48R"
+
+// KVStore on mbed (if the storage is configured), file on host
+#if !defined(__MBED__) || defined(MBED_CONF_STORAGE_STORAGE_TYPE)
+  #define DS248X_REGISTRY_STORAGE
+#endif
+
+/**
+ * @brief Known devices of all bridges with lookup by ROM
+ *
+ * On startup the stored devices are confirmed (by Read ROM if alone on
+ * the channel, otherwise by a search pass each) and the bus is enumerated
+ * only if some of them are missing. A device added to a channel with more
+ * known devices while none was removed is found only by scan().
+ */
+class DS248XRegistry {
+ public:
+  typedef struct {
+    char rom[8];  // family code is the first byte
+    uint8_t bridge;
+    uint8_t channel;
+    uint16_t reserved;
+    uint32_t last_seen;  // application time, ie. seconds
+  } ds248x_entry_t;
+
+  DS248XRegistry();
+
+  /**
+   * @brief Add device or update where and when it was seen
+   *
+   * @param rom unique address of device
+   * @param bridge index of the bridge given by the application
+   * @param channel channel of the bridge
+   * @param seen time the device was seen
+   * @return true if successful, false if full
+   */
+  bool add(const char* rom, uint8_t bridge, uint8_t channel, uint32_t seen);
+
+  /**
+   * @brief Find device
+   *
+   * @param rom unique address of device
+   * @return entry, nullptr if not known
+   */
+  ds248x_entry_t* find(const char* rom);
+
+  /**
+   * @brief Forget devices not seen since given time
+   *
+   * @param since time
+   * @return number of removed devices
+   */
+  size_t prune(uint32_t since);
+
+  /**
+   * @brief Forget all devices
+   *
+   */
+  void clear();
+
+  /**
+   * @brief Number of known devices
+   *
+   * @return count
+   */
+  size_t count() const {
+    return _store.count;
+  }
+
+  /**
+   * @brief Get device by position
+   *
+   * @param index position (0 - count()-1)
+   * @return entry
+   */
+  const ds248x_entry_t* entry(size_t index) const {
+    return (index < _store.count) ? &_store.entries[index] : nullptr;
+  }
+
+  /**
+   * @brief Confirm known devices of the bridge and enumerate it if the
+   * number of present devices differs from the stored one
+   *
+   * @param bridge bridge to check
+   * @param index index of the bridge
+   * @param now current time
+   * @param searched place to put whether the bus was enumerated (optional)
+   * @param channels number of channels, limited to the channels of the bridge
+   * @return number of present devices
+   */
+  size_t start(DS248X* bridge, uint8_t index, uint32_t now, bool* searched = nullptr,
+               uint8_t channels = DS248X_CHANNELS);
+
+  /**
+   * @brief Confirm known devices of the bridge, by Read ROM if alone on the channel
+   * or by a search pass
+   *
+   * @param bridge bridge to check
+   * @param index index of the bridge
+   * @param now time to put to present devices
+   * @param channels number of channels, limited to the channels of the bridge
+   * @return number of present devices
+   */
+  size_t confirm(DS248X* bridge, uint8_t index, uint32_t now, uint8_t channels = DS248X_CHANNELS);
+
+  /**
+   * @brief Enumerate all channels of the bridge and add found devices
+   *
+   * @param bridge bridge to enumerate
+   * @param index index of the bridge
+   * @param now time to put to found devices
+   * @param channels number of channels, limited to the channels of the bridge
+   * @return number of found devices
+   */
+  size_t scan(DS248X* bridge, uint8_t index, uint32_t now, uint8_t channels = DS248X_CHANNELS);
+
+  /**
+   * @brief Get the registry as blob (native byte order) for custom storage
+   *
+   * @param len place to put the size of the blob
+   * @return blob, valid until next change
+   */
+  const char* serialize(size_t* len);
+
+  /**
+   * @brief Replace the registry by blob from serialize()
+   *
+   * @param data blob
+   * @param len size of the blob
+   * @return true if successful, false if the blob is not valid
+   */
+  bool deserialize(const char* data, size_t len);
+
+#if defined(DS248X_REGISTRY_STORAGE)
+  /**
+   * @brief Store the registry to KVStore (mbed) or file (host)
+   *
+   * @param key KVStore key (ie. "/kv/ds248x") or file path
+   * @return true if successful, otherwise false
+   */
+  bool save(const char* key);
+
+  /**
+   * @brief Load the registry stored by save()
+   *
+   * @param key KVStore key (ie. "/kv/ds248x") or file path
+   * @return true if successful, otherwise false
+   */
+  bool load(const char* key);
+#endif
+
+ private:
+  typedef enum {
+    ROM_READ = 0x33,
+  } ds248x_rom_cmd_t;
+
+  // blob layout, header is followed by count entries
+  typedef struct {
+    uint32_t magic;
+    uint16_t count;
+    uint16_t crc;  // CRC16 of the entries
+    ds248x_entry_t entries[MBED_CONF_DS248X_REGISTRY_SIZE];
+  } registry_t;
+
+  registry_t _store = {};
+  uint16_t _slots[DS248X_REGISTRY_SLOTS];  // entry index, UINT16_MAX if empty
+
+  /**
+   * @brief Check that the device is on the selected channel
+   *
+   * @param bridge bridge to use
+   * @param rom unique address of device
+   * @param alone the only known device on the channel
+   * @return true if device on the bus, otherwise false
+   */
+  bool check(DS248X* bridge, const char* rom, bool alone);
+
+  /**
+   * @brief Slot of the ROM or the empty one where it would go
+   *
+   * @param rom unique address of device
+   * @return slot
+   */
+  size_t slot(const char* rom) const;
+
+  /**
+   * @brief Build lookup table from the entries
+   *
+   */
+  void reindex();
+
+  /**
+   * @brief Size of the blob
+   *
+   * @return size
+   */
+  size_t blobSize() const;
+};
+
+#endif  // DS248X_REGISTRY_H
@@ -0,0 +1,152 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "DS248XScheduler.h"
+
+DS248XScheduler::DS248XScheduler() {}
+
+#if defined(__MBED__)
+DS248XScheduler::DS248XScheduler(EventQueue *queue) : _event_queue(queue) {}
+#endif
+
+bool DS248XScheduler::add(DS248XAsync *engine, uint8_t *index) {
+  MBED_ASSERT(engine);
+
+  if (_count >= DS248X_SCHEDULER_BRIDGES) {
+    tr_error("Too many bridges");
+    return false;
+  }
+
+  if (index) {
+    *index = _count;
+  }
+
+  _engines[_count] = engine;
+  _due[_count] = 0us;
+  _count++;
+
+  return true;
+}
+
+bool DS248XScheduler::submit(uint8_t bridge, DS248XAsync::ds248x_request_t *request) {
+  bool idle;
+
+  if (bridge >= _count) {
+    tr_error("Invalid bridge");
+    return false;
+  }
+
+  idle = !_engines[bridge]->busy();
+
+  if (!_engines[bridge]->submit(request)) {
+    return false;
+  }
+
+  if (idle) {
+    _due[bridge] = 0us;
+
+#if defined(__MBED__)
+    // don't let the new request wait for other bridges
+    if (_event_queue) {
+      schedule(0us);
+    }
+#endif
+  }
+
+  return true;
+}
+
+bool DS248XScheduler::busy() const {
+  for (uint8_t i = 0; i < _count; i++) {
+    if (_engines[i]->busy()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+microseconds DS248XScheduler::process() {
+  microseconds delay = microseconds::max();
+  microseconds now;
+  microseconds next;
+  uint8_t i;
+
+  // one step per bridge, round robin, so a bridge with long transfer doesn't starve others
+  for (uint8_t n = 0; n < _count; n++) {
+    i = (_next + n) % _count;
+
+    if (!_engines[i]->busy() || _engines[i]->now() < _due[i]) {
+      continue;
+    }
+
+    next = _engines[i]->process();
+    _due[i] = (next == microseconds::max()) ? 0us : (_engines[i]->now() + next);
+  }
+
+  if (_count > 0) {
+    _next = (_next + 1) % _count;
+  }
+
+  for (i = 0; i < _count; i++) {
+    if (!_engines[i]->busy()) {
+      continue;
+    }
+
+    now = _engines[i]->now();
+    next = (_due[i] > now) ? (_due[i] - now) : 0us;
+
+    if (next < delay) {
+      delay = next;
+    }
+  }
+
+  return delay;
+}
+
+#if defined(__MBED__)
+void DS248XScheduler::run() {
+  schedule(process());
+}
+
+void DS248XScheduler::wake() {
+  // called from interrupt, I2C must be accessed from the queue
+  _event_queue->call(callback(this, &DS248XScheduler::run));
+}
+
+void DS248XScheduler::schedule(microseconds delay) {
+  _timeout.detach();
+
+  if (delay == microseconds::max()) {
+    return;
+  }
+
+  if (delay.count() > 0) {
+    _timeout.attach(callback(this, &DS248XScheduler::wake), delay);
+
+  } else if (_event_queue->call(callback(this, &DS248XScheduler::run)) == 0) {
+    tr_error("Event queue full");
+  }
+}
+#endif
@@ -0,0 +1,101 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DS248X_SCHEDULER_H
+#define DS248X_SCHEDULER_H
+
+#include "DS248XAsync.h"
+
+#define DS248X_SCHEDULER_BRIDGES 4  // 7-bit addresses 0x18 ... 0x1B
+
+/**
+ * @brief Interleaves several bridges on one I2C bus
+ *
+ * While one bridge is busy with 1-Wire activity, the bus is used to issue
+ * commands to the other bridges, a bridge is polled only once its command
+ * is expected to be finished. Every step of DS248XAsync ends with STOP,
+ * so the transactions of different bridges never overlap.
+ */
+class DS248XScheduler {
+ public:
+  DS248XScheduler();
+#if defined(__MBED__)
+  /**
+   * @brief Create scheduler which schedules itself on the queue
+   *
+   * @param queue event queue to run the steps from
+   */
+  DS248XScheduler(EventQueue* queue);
+#endif
+
+  /**
+   * @brief Add engine of a bridge, the engine must be created without event queue
+   *
+   * @param engine engine of the bridge
+   * @param index place to put the index of the bridge
+   * @return true if successful, otherwise false
+   */
+  bool add(DS248XAsync* engine, uint8_t* index = nullptr);
+
+  /**
+   * @brief Queue request for a bridge, the request must stay valid until done
+   *
+   * @param bridge index of the bridge
+   * @param request request to process
+   * @return true if queued, otherwise false
+   */
+  bool submit(uint8_t bridge, DS248XAsync::ds248x_request_t* request);
+
+  /**
+   * @brief Whether any bridge has pending request
+   *
+   * @return true if busy
+   */
+  bool busy() const;
+
+  /**
+   * @brief Advance every bridge which is due by one step, called from the
+   * event queue or by the application when no queue is attached
+   *
+   * @return time after which to call again, microseconds::max() if idle
+   */
+  microseconds process();
+
+ private:
+  DS248XAsync* _engines[DS248X_SCHEDULER_BRIDGES] = {};
+  microseconds _due[DS248X_SCHEDULER_BRIDGES] = {};
+  uint8_t _count = 0;
+  uint8_t _next = 0;
+
+#if defined(__MBED__)
+  EventQueue* _event_queue = nullptr;
+  Timeout _timeout;
+
+  void run();
+  void wake();
+  void schedule(microseconds delay);
+#endif
+};
+
+#endif  // DS248X_SCHEDULER_H
@@ -0,0 +1,1023 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "DS248XSim.h"
+
+#if !defined(__MBED__)
+  // 1-Wire timing in ns, datasheet typical values
+  #define DS248X_SIM_RESET_NS 1148000
+  #define DS248X_SIM_RESET_OD_NS 144000
+  #define DS248X_SIM_SLOT_NS 72800
+  #define DS248X_SIM_SLOT_OD_NS 10600
+
+static const uint8_t channel_codes[8] = {0xF0, 0xE1, 0xD2, 0xC3, 0xB4, 0xA5, 0x96, 0x87};
+static const uint8_t channel_readback[8] = {0xB8, 0xB1, 0xAA, 0xA3, 0x9C, 0x95, 0x8E, 0x87};
+
+DS248XSimSlave::DS248XSimSlave(const char *rom) {
+  memcpy(_rom, rom, sizeof(_rom));
+}
+
+DS248XSimSlave::DS248XSimSlave(uint8_t family_code, uint64_t serial) {
+  _rom[0] = family_code;
+
+  for (size_t i = 1; i < 7; i++) {
+    _rom[i] = static_cast<char>(serial & 0xFF);
+    serial >>= 8;
+  }
+
+  _rom[7] = DS248X::computeCRC(_rom, 7);
+}
+
+bool DS248XSimSlave::romBit(uint8_t bit) const {
+  return _rom[bit / 8] & (1 << (bit % 8));
+}
+
+void DS248XSimSlave::reset(bool overdrive) {
+  // standard speed reset returns every device to standard speed
+  _overdrive = _overdrive && overdrive;
+  _state = STATE_ROM_COMMAND;
+  _bit = 0;
+  _phase = 0;
+  _shift = 0;
+  _shift_count = 0;
+  _tx_count = 0;
+  _transmitting = false;
+
+  onReset();
+}
+
+void DS248XSimSlave::select() {
+  _state = STATE_FUNCTION;
+  _shift = 0;
+  _shift_count = 0;
+  _tx_count = 0;
+
+  onSelect();
+}
+
+bool DS248XSimSlave::drive() {
+  switch (_state) {
+    case STATE_SEARCH:
+      if (_phase == 0) {
+        return romBit(_bit);
+
+      } else if (_phase == 1) {
+        return !romBit(_bit);
+      }
+
+      return true;
+
+    case STATE_READ_ROM:
+      return romBit(_bit);
+
+    case STATE_FUNCTION: {
+      if (_tx_count == 0) {
+        _transmitting = onRead(&_tx);
+
+        if (!_transmitting) {
+          return true;
+        }
+
+        _tx_count = 8;
+      }
+
+      bool bit = _tx & 1;
+      _tx >>= 1;
+      _tx_count--;
+
+      return bit;
+    }
+
+    default:
+      return true;
+  }
+}
+
+void DS248XSimSlave::sample(bool line) {
+  bool resume;
+
+  switch (_state) {
+    case STATE_ROM_COMMAND:
+      _shift |= (line ? 1 : 0) << _shift_count;
+
+      if (++_shift_count < 8) {
+        break;
+      }
+
+      _shift_count = 0;
+      _bit = 0;
+      _phase = 0;
+
+      // any ROM command except Resume clears RC flag, it gets set when matched or found
+      resume = _rc && _resume_capable;
+      _rc = false;
+
+      switch (_shift) {
+        case 0x33:  // read ROM
+          _state = STATE_READ_ROM;
+          break;
+
+        case 0x55:  // match ROM
+          _state = STATE_MATCH;
+          break;
+
+        case 0xCC:  // skip ROM
+          select();
+          break;
+
+        case 0xF0:  // search ROM
+          _state = STATE_SEARCH;
+          break;
+
+        case 0xEC:  // alarm search
+          _state = alarm() ? STATE_SEARCH : STATE_IDLE;
+          break;
+
+        case 0x3C:  // overdrive skip ROM
+          if (_overdrive_capable) {
+            _overdrive = true;
+            select();
+
+          } else {
+            _state = STATE_IDLE;
+          }
+
+          break;
+
+        case 0x69:  // overdrive match ROM, the ROM follows at overdrive speed
+          _overdrive = _overdrive_capable;
+          _state = _overdrive_capable ? STATE_MATCH : STATE_IDLE;
+          break;
+
+        case 0xA5:  // resume, selects the device matched last
+          if (resume) {
+            _rc = true;
+            select();
+
+          } else {
+            _state = STATE_IDLE;
+          }
+
+          break;
+
+        default:
+          _state = STATE_IDLE;
+          break;
+      }
+
+      _shift = 0;
+      break;
+
+    case STATE_SEARCH:
+      if (_phase < 2) {
+        _phase++;
+        break;
+      }
+
+      _phase = 0;
+
+      if (line != romBit(_bit)) {
+        _state = STATE_IDLE;
+
+      } else if (++_bit == 64) {
+        _rc = true;
+        select();
+      }
+
+      break;
+
+    case STATE_MATCH:
+      if (line != romBit(_bit)) {
+        _state = STATE_IDLE;
+        _overdrive = false;
+
+      } else if (++_bit == 64) {
+        _rc = true;
+        select();
+      }
+
+      break;
+
+    case STATE_READ_ROM:
+      if (++_bit == 64) {
+        select();
+      }
+
+      break;
+
+    case STATE_FUNCTION:
+      if (_transmitting) {
+        break;
+      }
+
+      _shift |= (line ? 1 : 0) << _shift_count;
+
+      if (++_shift_count == 8) {
+        uint8_t data = _shift;
+
+        _shift = 0;
+        _shift_count = 0;
+        onWrite(data);
+      }
+
+      break;
+
+    default:
+      break;
+  }
+}
+
+DS248XSimDS18B20::DS248XSimDS18B20(uint64_t serial, int16_t raw) : DS248XSimSlave(0x28, serial), _temperature(raw) {
+  _scratchpad[0] = static_cast<char>(raw & 0xFF);
+  _scratchpad[1] = static_cast<char>(raw >> 8);
+  _scratchpad[2] = 0x4B;  // TH
+  _scratchpad[3] = 0x46;  // TL
+  _scratchpad[4] = 0x7F;  // 12-bit resolution
+  _scratchpad[5] = static_cast<char>(0xFF);
+  _scratchpad[6] = 0x0C;
+  _scratchpad[7] = 0x10;
+
+  updateCRC();
+}
+
+void DS248XSimDS18B20::onReset() {
+  _command = 0;
+  _index = 0;
+}
+
+void DS248XSimDS18B20::onWrite(uint8_t data) {
+  if (_command == 0x4E) {  // write scratchpad: TH, TL, config
+    _scratchpad[2 + _index] = static_cast<char>(data);
+
+    if (++_index == 3) {
+      _command = 0;
+      updateCRC();
+    }
+
+    return;
+  }
+
+  _command = data;
+  _index = 0;
+
+  if (_command == 0x44) {  // convert T
+    _scratchpad[0] = static_cast<char>(_temperature & 0xFF);
+    _scratchpad[1] = static_cast<char>(_temperature >> 8);
+    updateCRC();
+
+    // integer part compared against TH and TL
+    _alarm = (_temperature >> 4) >= static_cast<int8_t>(_scratchpad[2]) ||
+             (_temperature >> 4) <= static_cast<int8_t>(_scratchpad[3]);
+  }
+}
+
+bool DS248XSimDS18B20::alarm() const {
+  return _alarm;
+}
+
+bool DS248XSimDS18B20::onRead(uint8_t *data) {
+  if (_command != 0xBE) {  // read scratchpad
+    return false;
+  }
+
+  *data = (_index < sizeof(_scratchpad)) ? static_cast<uint8_t>(_scratchpad[_index++]) : 0xFF;
+  return true;
+}
+
+void DS248XSimDS18B20::updateCRC() {
+  _scratchpad[8] = DS248X::computeCRC(_scratchpad, 8);
+}
+
+DS248XSimEEPROM::DS248XSimEEPROM(uint8_t family_code, uint64_t serial) : DS248XSimSlave(family_code, serial) {
+  bool ds2431 = (family_code == 0x2D);
+
+  _memory.assign(ds2431 ? 0x90 : 0xA20, static_cast<char>(0xFF));
+  _row = ds2431 ? 8 : 32;
+
+  setOverdriveCapable(true);
+  setResumeCapable(true);
+}
+
+void DS248XSimEEPROM::onReset() {
+  _command = 0;
+  _index = 0;
+  _copied = false;
+}
+
+void DS248XSimEEPROM::onWrite(uint8_t data) {
+  uint16_t offset;
+
+  if (_command == 0) {
+    _command = data;
+    _index = 0;
+    _crc = DS248XCRC::update16(0, data);
+    return;
+  }
+
+  _crc = DS248XCRC::update16(_crc, data);
+
+  // target address first
+  if (_index < 2) {
+    _address = (_index == 0) ? data : (_address | (data << 8));
+    _index++;
+
+    if (_index == 2 && _command == 0x0F) {
+      _ta = _address;
+      _es = (_ta % _row) | 0x20;  // PF until data come
+    }
+
+    return;
+  }
+
+  switch (_command) {
+    case 0x0F: {  // write scratchpad
+      offset = (_ta % _row) + (_index - 2);
+
+      if (offset < _row) {
+        _scratchpad[offset] = data;
+        _es = offset;
+      }
+
+      _index++;
+    } break;
+
+    case 0x55:  // copy scratchpad, authorized by TA and E/S
+      if (_index++ == 2 && _address == _ta && data == _es && _ta + _row <= _memory.size()) {
+        offset = _ta % _row;
+        memcpy(&_memory[_ta], &_scratchpad[offset], (_es & (_row - 1)) - offset + 1);
+        _es |= 0x80;
+        _copied = true;
+      }
+
+      break;
+
+    default:
+      break;
+  }
+}
+
+bool DS248XSimEEPROM::onRead(uint8_t *data) {
+  uint16_t offset;
+
+  switch (_command) {
+    case 0x0F:  // write scratchpad, inverted CRC once filled up
+      offset = (_ta % _row) + (_index - 2);
+
+      if (_index < 2 || offset < _row || _index > (_row - (_ta % _row)) + 3) {
+        return false;
+      }
+
+      *data = (_index++ == (_row - (_ta % _row)) + 2) ? ~_crc & 0xFF : ~_crc >> 8;
+      return true;
+
+    case 0xAA: {  // read scratchpad
+      uint16_t len = (_es & (_row - 1)) - (_ta % _row) + 1;
+
+      if (_index == 0) {
+        *data = _ta & 0xFF;
+
+      } else if (_index == 1) {
+        *data = _ta >> 8;
+
+      } else if (_index == 2) {
+        *data = _es;
+
+      } else if (_index < 3 + len) {
+        *data = _scratchpad[(_ta % _row) + _index - 3];
+
+      } else if (_index == 3 + len) {
+        *data = ~_crc & 0xFF;
+
+      } else if (_index == 4 + len) {
+        *data = ~_crc >> 8;
+
+      } else {
+        *data = 0xFF;
+      }
+
+      if (_index < 3 + len) {
+        _crc = DS248XCRC::update16(_crc, *data);
+      }
+
+      _index++;
+      return true;
+    }
+
+    case 0x55:  // copy scratchpad, alternating pattern when done
+      if (!_copied) {
+        return false;
+      }
+
+      *data = 0xAA;
+      return true;
+
+    case 0xF0:  // read memory
+      if (_index < 2) {
+        return false;
+      }
+
+      *data = (_address < _memory.size()) ? _memory[_address++] : 0xFF;
+      return true;
+
+    case 0xA5:  // extended read memory, inverted CRC after every page
+      if (_index < 2) {
+        return false;
+      }
+
+      if (_index == 2) {
+        *data = (_address < _memory.size()) ? _memory[_address] : 0xFF;
+        _crc = DS248XCRC::update16(_crc, *data);
+
+        if (++_address % 32 == 0) {
+          _index = 3;
+        }
+
+      } else {
+        *data = (_index == 3) ? ~_crc & 0xFF : ~_crc >> 8;
+
+        if (++_index == 5) {
+          _index = 2;
+          _crc = 0;
+        }
+      }
+
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+DS248XSim::DS248XSim(ds248x_sim_variant_t variant, uint8_t address, uint32_t frequency)
+    : _variant(variant), _address(address & 0xFE), _bit_ns(1000000000ULL / frequency) {
+  for (auto &channel : _channels) {
+    channel.shorted = false;
+  }
+
+  memset(_port, DS248X_PORT_DEFAULT, sizeof(_port));
+  resetStats();
+}
+
+void DS248XSim::add(DS248XSimSlave *slave, uint8_t channel) {
+  MBED_ASSERT(channel < 8);
+  _channels[channel].slaves.push_back(slave);
+}
+
+void DS248XSim::clear(uint8_t channel) {
+  MBED_ASSERT(channel < 8);
+  _channels[channel].slaves.clear();
+  _channels[channel].active.clear();
+}
+
+void DS248XSim::setShort(uint8_t channel, bool shorted) {
+  MBED_ASSERT(channel < 8);
+  _channels[channel].shorted = shorted;
+}
+
+void DS248XSim::setLineRecovery(nanoseconds time) {
+  _line_recovery = time;
+}
+
+microseconds DS248XSim::elapsed() const {
+  return microseconds(_now_ns / 1000);
+}
+
+void DS248XSim::elapse(microseconds time) {
+  _now_ns += time.count() * 1000;
+}
+
+DS248XSim::ds248x_sim_stats_t DS248XSim::stats() const {
+  return _stats;
+}
+
+void DS248XSim::resetStats() {
+  _stats = ds248x_sim_stats_t();
+  _i2c_ns = 0;
+  _wire_ns = 0;
+  _spu_ns = 0;
+}
+
+int DS248XSim::write(int address, const char *data, int length, bool repeated) {
+  if (!start(address)) {
+    return -1;
+  }
+
+  clock(length * 9);
+  _stats.bytes_written += length;
+
+  bool ack = (length == 0) || command(data, length);
+
+  if (!repeated) {
+    stop();
+  }
+
+  if (!ack) {
+    _stats.nacks++;
+    return -1;
+  }
+
+  return 0;
+}
+
+int DS248XSim::read(int address, char *data, int length, bool repeated) {
+  if (!start(address)) {
+    return -1;
+  }
+
+  for (int i = 0; i < length; i++) {
+    data[i] = static_cast<char>(registerValue());
+    clock(9);
+  }
+
+  _stats.bytes_read += length;
+
+  if (!repeated) {
+    stop();
+  }
+
+  return 0;
+}
+
+int DS248XSim::stop() {
+  if (_held) {
+    clock(1);
+    _held = false;
+  }
+
+  return 0;
+}
+
+microseconds DS248XSim::now() {
+  return elapsed();
+}
+
+void DS248XSim::wait(microseconds time) {
+  elapse(time);
+}
+
+void DS248XSim::clock(uint32_t bits) {
+  uint64_t time = bits * _bit_ns;
+
+  _now_ns += time;
+  _i2c_ns += time;
+  _stats.i2c_time = microseconds(_i2c_ns / 1000);
+}
+
+bool DS248XSim::start(int address) {
+  if (_held) {
+    _stats.repeated_starts++;
+
+  } else {
+    _stats.transactions++;
+  }
+
+  _held = true;
+  clock(1 + 9);
+
+  if ((address & 0xFE) != _address) {
+    _stats.nacks++;
+    stop();
+    return false;
+  }
+
+  return true;
+}
+
+bool DS248XSim::busy() const {
+  return _now_ns < _busy_until_ns;
+}
+
+uint8_t DS248XSim::registerValue() {
+  switch (_pointer) {
+    case 0xE1:  // data
+      return _data;
+
+    case 0xC3:  // config
+      return _config;
+
+    case 0xB4:  // port configuration, 8 bytes
+      return _port[_port_index++ % sizeof(_port)];
+
+    case 0xD2:  // channel selection
+      return channel_readback[_channel];
+
+    default:  // status
+      return _status | (busy() ? DS248X_STATUS_1WB : 0);
+  }
+}
+
+bool DS248XSim::command(const char *data, int length) {
+  uint8_t cmd = data[0];
+  uint8_t param = (length > 1) ? data[1] : 0;
+
+  // 1-Wire commands, WCFG and CHSL need the 1-Wire line idle
+  if (busy() && cmd != 0xF0 && cmd != 0xE1) {
+    return false;
+  }
+
+  if (cmd != 0xE1) {
+    endPullUp();
+  }
+
+  switch (cmd) {
+    case 0xF0:  // device reset
+      if (length != 1) {
+        return false;
+      }
+
+      _config = 0;
+      _channel = 0;
+      memset(_port, DS248X_PORT_DEFAULT, sizeof(_port));
+      _status = DS248X_STATUS_RST | DS248X_STATUS_LL;
+      _pointer = 0xF0;
+      _busy_until_ns = _now_ns;
+      break;
+
+    case 0xE1:  // set read pointer
+      if (length != 2) {
+        return false;
+      }
+
+      if (param != 0xF0 && param != 0xE1 && param != 0xC3 && !(param == 0xD2 && _variant == DS2482_800) &&
+          !(param == 0xB4 && _variant == DS2484)) {
+        return false;
+      }
+
+      _pointer = param;
+      _port_index = 0;
+      break;
+
+    case 0xD2:  // write configuration
+      if (length != 2) {
+        return false;
+      }
+
+      if ((param & 0x0F) == ((~param >> 4) & 0x0F)) {
+        _config = param & 0x0F;
+        _status &= ~DS248X_STATUS_RST;
+      }
+
+      _pointer = 0xC3;
+      break;
+
+    case 0xC3:  // channel select, adjust 1-Wire port on DS2484
+      if (length == 2 && _variant == DS2484 && (param >> 5) <= 4) {
+        adjustPort(param);
+        break;
+      }
+
+      if (length != 2 || _variant != DS2482_800) {
+        return false;
+      }
+
+      for (uint8_t i = 0; i < 8; i++) {
+        if (channel_codes[i] == param) {
+          _channel = i;
+        }
+      }
+
+      _pointer = 0xD2;
+      _stats.channel_selects++;
+      break;
+
+    case 0xB4:  // 1-Wire reset
+      if (length != 1) {
+        return false;
+      }
+
+      wireReset();
+      break;
+
+    case 0xA5:  // 1-Wire write byte
+      if (length != 2) {
+        return false;
+      }
+
+      for (uint8_t i = 0; i < 8; i++) {
+        wireSlot(param & (1 << i));
+      }
+
+      wireBusy(8);
+      break;
+
+    case 0x96:  // 1-Wire read byte
+      if (length != 1) {
+        return false;
+      }
+
+      _data = 0;
+
+      for (uint8_t i = 0; i < 8; i++) {
+        if (wireSlot(true)) {
+          _data |= (1 << i);
+        }
+      }
+
+      wireBusy(8);
+      break;
+
+    case 0x87:  // 1-Wire single bit
+      if (length != 2) {
+        return false;
+      }
+
+      _status &= ~DS248X_STATUS_SBR;
+
+      if (wireSlot(param & 0x80)) {
+        _status |= DS248X_STATUS_SBR;
+      }
+
+      wireBusy(1);
+      break;
+
+    case 0x78: {  // 1-Wire triplet
+      if (length != 2) {
+        return false;
+      }
+
+      bool id_bit = wireSlot(true);
+      bool cmp_id_bit = wireSlot(true);
+      bool direction = (id_bit != cmp_id_bit) ? id_bit : (id_bit || (param & 0x80));
+
+      wireSlot(direction);
+
+      _status &= ~(DS248X_STATUS_SBR | DS248X_STATUS_TSB | DS248X_STATUS_DIR);
+      _status |= (id_bit ? DS248X_STATUS_SBR : 0) | (cmp_id_bit ? DS248X_STATUS_TSB : 0) |
+                 (direction ? DS248X_STATUS_DIR : 0);
+
+      wireBusy(3);
+    } break;
+
+    default:
+      return false;
+  }
+
+  _stats.commands++;
+  return true;
+}
+
+void DS248XSim::wireBusy(uint32_t slots, bool reset) {
+  bool overdrive = _config & DS248X_CONFIG_WS;
+  uint64_t time;
+
+  // datasheet timing shifted by the port parameters of DS2484
+  if (reset) {
+    time = overdrive ? DS248X_SIM_RESET_OD_NS : DS248X_SIM_RESET_NS;
+    time += portDelta(DS248X::PortResetLow, _port[overdrive], overdrive).count();
+
+  } else {
+    time = overdrive ? DS248X_SIM_SLOT_OD_NS : DS248X_SIM_SLOT_NS;
+    time += portDelta(DS248X::PortWriteZeroLow, _port[4 + overdrive], overdrive).count();
+    time += portDelta(DS248X::PortRecovery, _port[6], overdrive).count();
+    time *= slots;
+  }
+
+  _busy_until_ns = _now_ns + time;
+  _wire_ns += time;
+  _stats.wire_time = microseconds(_wire_ns / 1000);
+
+  // strong pullup follows the activity until the next command
+  if (_config & DS248X_CONFIG_SPU) {
+    _spu = true;
+    _spu_since_ns = _busy_until_ns;
+  }
+
+  _config &= ~DS248X_CONFIG_SPU;
+  _pointer = 0xF0;
+}
+
+void DS248XSim::endPullUp() {
+  if (!_spu) {
+    return;
+  }
+
+  if (_now_ns > _spu_since_ns) {
+    _spu_ns += _now_ns - _spu_since_ns;
+  }
+
+  _spu = false;
+  _stats.spu_time = microseconds(_spu_ns / 1000);
+}
+
+void DS248XSim::wireReset() {
+  channel_t &channel = _channels[_channel];
+  bool overdrive = _config & DS248X_CONFIG_WS;
+  // devices need tRSTL of at least 480 us / 48 us
+  bool long_enough = DS248X::portTime(DS248X::PortResetLow, _port[overdrive], overdrive) >=
+                     (overdrive ? 48000ns : 480000ns);
+
+  channel.active.clear();
+  _line_low = false;
+
+  if (!channel.shorted && long_enough) {
+    for (auto slave : channel.slaves) {
+      // standard speed devices don't see the short overdrive reset
+      if (overdrive && !slave->_overdrive) {
+        continue;
+      }
+
+      slave->reset(overdrive);
+      channel.active.push_back(slave);
+    }
+  }
+
+  _status &= ~(DS248X_STATUS_PPD | DS248X_STATUS_SD | DS248X_STATUS_LL);
+  _status |= channel.shorted ? DS248X_STATUS_SD : DS248X_STATUS_LL;
+  _status |= channel.active.empty() ? 0 : DS248X_STATUS_PPD;
+  _stats.wire_resets++;
+
+  wireBusy(0, true);
+}
+
+bool DS248XSim::wireSlot(bool bit) {
+  channel_t &channel = _channels[_channel];
+  bool overdrive = _config & DS248X_CONFIG_WS;
+  bool line = bit && !channel.shorted;
+  size_t count = 0;
+
+  // line didn't get back high after previous low slot
+  if (_line_low && DS248X::portTime(DS248X::PortRecovery, _port[6]) < _line_recovery) {
+    line = false;
+  }
+
+  // devices ignore slots at other speed
+  for (auto slave : channel.active) {
+    if (slave->_overdrive == overdrive) {
+      line &= slave->drive();
+    }
+  }
+
+  for (auto slave : channel.active) {
+    if (slave->_overdrive == overdrive) {
+      slave->sample(line);
+    }
+
+    if (slave->_state != DS248XSimSlave::STATE_IDLE) {
+      channel.active[count++] = slave;
+    }
+  }
+
+  channel.active.resize(count);
+  _stats.wire_slots++;
+  _line_low = !line;
+
+  return line;
+}
+
+void DS248XSim::adjustPort(uint8_t param) {
+  uint8_t select = param >> 5;
+  bool overdrive = param & 0x10;
+
+  // tRSTL, tMSP and tW0L have value per speed
+  _port[(select < 3) ? (select * 2 + overdrive) : (select + 3)] = param & 0x0F;
+  _pointer = 0xB4;
+  _port_index = 0;
+}
+
+nanoseconds DS248XSim::portDelta(DS248X::ds248x_port_param_t param, uint8_t value, bool overdrive) const {
+  return DS248X::portTime(param, value, overdrive) - DS248X::portTime(param, DS248X_PORT_DEFAULT, overdrive);
+}
+
+void DS248XSimBus::add(DS248XSim *sim) {
+  MBED_ASSERT(sim);
+
+  // joins at the time of the bus
+  if (!_sims.empty()) {
+    sim->_now_ns = _sims[0]->_now_ns;
+  }
+
+  _sims.push_back(sim);
+}
+
+microseconds DS248XSimBus::elapsed() const {
+  return _sims.empty() ? 0us : _sims[0]->elapsed();
+}
+
+DS248XSim::ds248x_sim_stats_t DS248XSimBus::stats() const {
+  DS248XSim::ds248x_sim_stats_t sum = DS248XSim::ds248x_sim_stats_t();
+  DS248XSim::ds248x_sim_stats_t stats;
+
+  for (const DS248XSim *sim : _sims) {
+    stats = sim->stats();
+    sum.transactions += stats.transactions;
+    sum.repeated_starts += stats.repeated_starts;
+    sum.bytes_written += stats.bytes_written;
+    sum.bytes_read += stats.bytes_read;
+    sum.nacks += stats.nacks;
+    sum.commands += stats.commands;
+    sum.channel_selects += stats.channel_selects;
+    sum.wire_resets += stats.wire_resets;
+    sum.wire_slots += stats.wire_slots;
+    sum.i2c_time += stats.i2c_time;
+    sum.wire_time += stats.wire_time;
+    sum.spu_time += stats.spu_time;
+  }
+
+  return sum;
+}
+
+void DS248XSimBus::resetStats() {
+  for (DS248XSim *sim : _sims) {
+    sim->resetStats();
+  }
+}
+
+int DS248XSimBus::write(int address, const char *data, int length, bool repeated) {
+  DS248XSim *sim = route(address);
+  uint64_t before_ns = sim->_now_ns;
+  int result = sim->write(address, data, length, repeated);
+
+  follow(sim, before_ns);
+  _held = sim->_held ? sim : nullptr;
+
+  return result;
+}
+
+int DS248XSimBus::read(int address, char *data, int length, bool repeated) {
+  DS248XSim *sim = route(address);
+  uint64_t before_ns = sim->_now_ns;
+  int result = sim->read(address, data, length, repeated);
+
+  follow(sim, before_ns);
+  _held = sim->_held ? sim : nullptr;
+
+  return result;
+}
+
+int DS248XSimBus::stop() {
+  uint64_t before_ns;
+
+  if (_held) {
+    before_ns = _held->_now_ns;
+    _held->stop();
+    follow(_held, before_ns);
+    _held = nullptr;
+  }
+
+  return 0;
+}
+
+microseconds DS248XSimBus::now() {
+  return elapsed();
+}
+
+void DS248XSimBus::wait(microseconds time) {
+  for (DS248XSim *sim : _sims) {
+    sim->elapse(time);
+  }
+}
+
+DS248XSim *DS248XSimBus::route(int address) {
+  DS248XSim *target;
+
+  MBED_ASSERT(!_sims.empty());
+
+  // nobody answers, the first one NACKs
+  target = _sims[0];
+
+  for (DS248XSim *sim : _sims) {
+    if (sim->getAddress() == (address & 0xFE)) {
+      target = sim;
+    }
+  }
+
+  // repeated start to another address, the previous bridge sees it as the end of its transaction
+  if (_held && _held != target) {
+    stop();
+  }
+
+  return target;
+}
+
+void DS248XSimBus::follow(const DS248XSim *sim, uint64_t before_ns) {
+  uint64_t time = sim->_now_ns - before_ns;
+
+  // the other bridges watched the bus meanwhile, their 1-Wire activity went on
+  for (DS248XSim *other : _sims) {
+    if (other != sim) {
+      other->_now_ns += time;
+    }
+  }
+}
+#endif
@@ -0,0 +1,452 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DS248X_SIM_H
+#define DS248X_SIM_H
+
+#include "DS248X.h"
+
+// host only, the simulator is not part of target builds
+#if !defined(__MBED__)
+  #include <vector>
+
+/**
+ * @brief Simulated 1-Wire slave
+ *
+ * Implements the ROM layer (Read ROM, Match ROM, Skip ROM, Search ROM, Alarm Search,
+ * Overdrive Skip ROM, Overdrive Match ROM, Resume),
+ * the function layer is left to derived classes.
+ */
+class DS248XSimSlave {
+ public:
+  /**
+   * @brief Create slave with given ROM
+   *
+   * @param rom unique address of device (8 bytes)
+   */
+  DS248XSimSlave(const char* rom);
+
+  /**
+   * @brief Create slave, ROM CRC is computed
+   *
+   * @param family_code family code
+   * @param serial 48-bit serial number
+   */
+  DS248XSimSlave(uint8_t family_code, uint64_t serial);
+  virtual ~DS248XSimSlave(void) {}
+
+  /**
+   * @brief Get unique address of device
+   *
+   * @return pointer to 8 bytes
+   */
+  const char* rom() const {
+    return _rom;
+  }
+
+  /**
+   * @brief Set whether the device supports overdrive speed
+   *
+   * @param capable true if supported
+   */
+  void setOverdriveCapable(bool capable) {
+    _overdrive_capable = capable;
+  }
+
+  /**
+   * @brief Set whether the device supports Resume
+   *
+   * @param capable true if supported
+   */
+  void setResumeCapable(bool capable) {
+    _resume_capable = capable;
+  }
+
+  /**
+   * @brief Get speed of the device
+   *
+   * @return true if at overdrive speed
+   */
+  bool overdrive() const {
+    return _overdrive;
+  }
+
+ protected:
+  /**
+   * @brief Called on every reset pulse on the bus
+   *
+   */
+  virtual void onReset() {}
+
+  /**
+   * @brief Called when the device gets selected by ROM command
+   *
+   */
+  virtual void onSelect() {}
+
+  /**
+   * @brief Called for every function byte received from master
+   *
+   * @param data received byte
+   */
+  virtual void onWrite(uint8_t data) {
+    (void)data;
+  }
+
+  /**
+   * @brief Called when the device may transmit next byte
+   *
+   * @param data place to put the byte
+   * @return true if transmitting, false if device listens
+   */
+  virtual bool onRead(uint8_t* data) {
+    (void)data;
+    return false;
+  }
+
+  /**
+   * @brief Whether the device responds to Alarm Search
+   *
+   * @return true if in alarm state
+   */
+  virtual bool alarm() const {
+    return false;
+  }
+
+ private:
+  friend class DS248XSim;
+
+  typedef enum { STATE_IDLE, STATE_ROM_COMMAND, STATE_SEARCH, STATE_MATCH, STATE_READ_ROM, STATE_FUNCTION } state_t;
+
+  char _rom[8];
+  state_t _state = STATE_IDLE;
+  uint8_t _bit = 0;
+  uint8_t _phase = 0;
+  uint8_t _shift = 0;
+  uint8_t _shift_count = 0;
+  uint8_t _tx = 0;
+  uint8_t _tx_count = 0;
+  bool _transmitting = false;
+  bool _overdrive_capable = false;
+  bool _overdrive = false;
+  bool _resume_capable = false;
+  bool _rc = false;  // selected by last Match ROM / Search ROM
+
+  bool romBit(uint8_t bit) const;
+  void reset(bool overdrive);
+  void select();
+  bool drive();
+  void sample(bool line);
+};
+
+/**
+ * @brief Simulated DS18B20 temperature sensor
+ *
+ */
+class DS248XSimDS18B20 : public DS248XSimSlave {
+ public:
+  DS248XSimDS18B20(uint64_t serial, int16_t raw = 0x0550);
+
+  /**
+   * @brief Set temperature which will be reported after next conversion
+   *
+   * @param raw temperature in 1/16 of degree Celsius
+   */
+  void setTemperature(int16_t raw) {
+    _temperature = raw;
+  }
+
+ protected:
+  virtual void onReset() override;
+  virtual void onWrite(uint8_t data) override;
+  virtual bool onRead(uint8_t* data) override;
+  virtual bool alarm() const override;
+
+ private:
+  int16_t _temperature;
+  bool _alarm = false;
+  char _scratchpad[9];
+  uint8_t _command = 0;
+  uint8_t _index = 0;
+
+  void updateCRC();
+};
+
+/**
+ * @brief Simulated DS2431 / DS28EC20 EEPROM
+ *
+ */
+class DS248XSimEEPROM : public DS248XSimSlave {
+ public:
+  /**
+   * @brief Create memory device
+   *
+   * @param family_code 0x2D for DS2431, 0x43 for DS28EC20
+   * @param serial 48-bit serial number
+   */
+  DS248XSimEEPROM(uint8_t family_code, uint64_t serial);
+
+  /**
+   * @brief Get memory content
+   *
+   * @return memory including registers
+   */
+  std::vector<char>& memory() {
+    return _memory;
+  }
+
+ protected:
+  virtual void onReset() override;
+  virtual void onWrite(uint8_t data) override;
+  virtual bool onRead(uint8_t* data) override;
+
+ private:
+  std::vector<char> _memory;
+  char _scratchpad[32];
+  uint8_t _row;
+  uint8_t _command = 0;
+  uint16_t _index = 0;
+  uint16_t _ta = 0;
+  uint8_t _es = 0;
+  uint16_t _address = 0;
+  uint16_t _crc = 0;
+  bool _copied = false;
+};
+
+/**
+ * @brief Behavioral model of DS2484 / DS2482-100 / DS2482-800
+ *
+ * Decodes commands, keeps status, config, channel and data registers
+ * and advances a simulated clock by I2C and 1-Wire timing, so transaction
+ * counts and bus time can be measured without hardware.
+ */
+class DS248XSim : public DS248XTransport {
+ public:
+  typedef enum { DS2484, DS2482_100, DS2482_800 } ds248x_sim_variant_t;
+
+  typedef struct {
+    uint32_t transactions;     // START ... STOP
+    uint32_t repeated_starts;  // repeated START within transaction
+    uint32_t bytes_written;    // data bytes, excluding address
+    uint32_t bytes_read;
+    uint32_t nacks;
+    uint32_t commands;  // accepted bridge commands
+    uint32_t channel_selects;
+    uint32_t wire_resets;
+    uint32_t wire_slots;
+    microseconds i2c_time;
+    microseconds wire_time;
+    microseconds spu_time;  // strong pullup on
+  } ds248x_sim_stats_t;
+
+  DS248XSim(ds248x_sim_variant_t variant = DS2482_100, uint8_t address = DS248X_DEFAULT_ADDRESS,
+            uint32_t frequency = 400000);
+
+  /**
+   * @brief Connect slave to the 1-Wire bus
+   *
+   * @param slave device, must outlive the simulator
+   * @param channel channel of DS2482-800, 0 otherwise
+   */
+  void add(DS248XSimSlave* slave, uint8_t channel = 0);
+
+  /**
+   * @brief Disconnect all slaves from the channel
+   *
+   * @param channel channel of DS2482-800, 0 otherwise
+   */
+  void clear(uint8_t channel = 0);
+
+  /**
+   * @brief Simulate short on the 1-Wire bus
+   *
+   * @param channel channel of DS2482-800, 0 otherwise
+   * @param shorted whether the bus is shorted
+   */
+  void setShort(uint8_t channel, bool shorted);
+
+  /**
+   * @brief Simulate long or heavily loaded line, slot after a low one is
+   * read low unless tREC0 of the bridge is at least this time
+   *
+   * @param time recovery the line needs
+   */
+  void setLineRecovery(nanoseconds time);
+
+  /**
+   * @brief Get the config register (without the inverted upper nibble)
+   *
+   * @return config
+   */
+  uint8_t getConfig() const {
+    return _config;
+  }
+
+  /**
+   * @brief Get the selected channel (DS2482-800)
+   *
+   * @return channel
+   */
+  uint8_t getChannel() const {
+    return _channel;
+  }
+
+  /**
+   * @brief Get the I2C address the bridge answers
+   *
+   * @return 8-bit address
+   */
+  uint8_t getAddress() const {
+    return _address;
+  }
+
+  /**
+   * @brief Get simulated time since start
+   *
+   * @return time
+   */
+  microseconds elapsed() const;
+
+  /**
+   * @brief Advance simulated time (ie. host side sleep)
+   *
+   * @param time duration
+   */
+  void elapse(microseconds time);
+
+  /**
+   * @brief Get statistics
+   *
+   * @return statistics since last resetStats()
+   */
+  ds248x_sim_stats_t stats() const;
+
+  /**
+   * @brief Clear statistics
+   *
+   */
+  void resetStats();
+
+  virtual int write(int address, const char* data, int length, bool repeated = false) override;
+  virtual int read(int address, char* data, int length, bool repeated = false) override;
+  virtual int stop() override;
+  virtual microseconds now() override;
+  virtual void wait(microseconds time) override;
+
+ private:
+  friend class DS248XSimBus;
+
+  typedef struct {
+    std::vector<DS248XSimSlave*> slaves;
+    std::vector<DS248XSimSlave*> active;
+    bool shorted;
+  } channel_t;
+
+  const ds248x_sim_variant_t _variant;
+  const uint8_t _address;
+  const uint64_t _bit_ns;
+
+  channel_t _channels[8];
+  uint8_t _channel = 0;
+  uint8_t _config = 0;
+  uint8_t _status = DS248X_STATUS_RST;
+  uint8_t _data = 0;
+  uint8_t _pointer = 0xF0;
+  uint64_t _now_ns = 0;
+  uint64_t _busy_until_ns = 0;
+  uint64_t _i2c_ns = 0;
+  uint64_t _wire_ns = 0;
+  uint64_t _spu_ns = 0;
+  uint64_t _spu_since_ns = 0;
+  bool _spu = false;
+  uint8_t _port[8];  // DS2484 port parameters in read order
+  uint8_t _port_index = 0;
+  nanoseconds _line_recovery = 0ns;
+  bool _line_low = false;
+  bool _held = false;
+  ds248x_sim_stats_t _stats;
+
+  void clock(uint32_t bits);
+  bool start(int address);
+  bool command(const char* data, int length);
+  uint8_t registerValue();
+  void wireBusy(uint32_t slots, bool reset = false);
+  void wireReset();
+  bool wireSlot(bool bit);
+  bool busy() const;
+  void endPullUp();
+  void adjustPort(uint8_t param);
+  nanoseconds portDelta(DS248X::ds248x_port_param_t param, uint8_t value, bool overdrive) const;
+};
+
+/**
+ * @brief I2C bus shared by several simulated bridges, each answers its own
+ * address and all of them run on one clock, so the 1-Wire activity of a
+ * bridge goes on while the bus talks to the others
+ */
+class DS248XSimBus : public DS248XTransport {
+ public:
+  /**
+   * @brief Connect bridge to the bus
+   *
+   * @param sim bridge with address of its own, must outlive the bus
+   */
+  void add(DS248XSim* sim);
+
+  /**
+   * @brief Get simulated time since start
+   *
+   * @return time
+   */
+  microseconds elapsed() const;
+
+  /**
+   * @brief Get statistics summed over the bridges
+   *
+   * @return statistics since last resetStats()
+   */
+  DS248XSim::ds248x_sim_stats_t stats() const;
+
+  /**
+   * @brief Clear statistics of all bridges
+   *
+   */
+  void resetStats();
+
+  virtual int write(int address, const char* data, int length, bool repeated = false) override;
+  virtual int read(int address, char* data, int length, bool repeated = false) override;
+  virtual int stop() override;
+  virtual microseconds now() override;
+  virtual void wait(microseconds time) override;
+
+ private:
+  std::vector<DS248XSim*> _sims;
+  DS248XSim* _held = nullptr;  // bridge of the open transaction
+
+  DS248XSim* route(int address);
+  void follow(const DS248XSim* sim, uint64_t before_ns);
+};
+#endif
+
+#endif  // DS248X_SIM_H
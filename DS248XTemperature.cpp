@@ -0,0 +1,179 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "DS248XTemperature.h"
+
+DS248XTemperature::DS248XTemperature(DS248X *bridge) : _bridge(bridge) {}
+
+bool DS248XTemperature::convert(bool spu, microseconds hold) {
+  DS248X::Session session(_bridge);
+  const char command = COMMAND_CONVERT;
+  tr_info("Convert all");
+
+  if (!_bridge->reset()) {
+    tr_warning("No devices on the bus");
+    return false;
+  }
+
+  if (!_bridge->skip()) {
+    return false;
+  }
+
+  if (spu && hold > 0us) {
+    return _bridge->writePowered(&command, 1, hold);
+  }
+
+  return _bridge->write(command, spu);
+}
+
+bool DS248XTemperature::read(ds248x_temperature_t *sensor, bool fast) {
+  DS248X::Session session(_bridge);
+  char data[9];
+  uint8_t crc = 0;
+
+  sensor->valid = false;
+
+  if (!_bridge->reset() || !_bridge->select(sensor->device.rom) || !_bridge->write(COMMAND_READ_SCRATCHPAD)) {
+    return false;
+  }
+
+  if (fast) {
+    // the rest of the scratchpad is dropped by the reset
+    if (!_bridge->readBytes(data, 2)) {
+      return false;
+    }
+
+    _bridge->reset();
+
+  } else {
+    if (!_bridge->readBytes(data, sizeof(data), &crc)) {
+      return false;
+    }
+
+    if (crc != 0) {
+      tr_error("Invalid CRC");
+      _bridge->crcFailed();
+      return false;
+    }
+  }
+
+  sensor->raw = toRaw(sensor->device.rom[0], data, !fast);
+  sensor->valid = true;
+
+  return true;
+}
+
+size_t DS248XTemperature::acquire(ds248x_temperature_t *sensors, size_t count, bool fast, bool spu,
+                                  microseconds conversion, uint8_t channels) {
+  uint8_t used = 0;
+  size_t done = 0;
+
+  if (channels > _bridge->channelCount()) {
+    channels = _bridge->channelCount();
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    sensors[i].valid = false;
+
+    if (sensors[i].device.channel < channels) {
+      used |= 1 << sensors[i].device.channel;
+    }
+  }
+
+  for (uint8_t channel = 0; channel < channels; channel++) {
+    if (!(used & (1 << channel))) {
+      continue;
+    }
+
+    // nobody may switch channel or end the strong pullup meanwhile
+    DS248X::Session session(_bridge);
+
+    // strong pullup powers only the selected channel, so it converts alone
+    if (!_bridge->selectChannel(channel) || !convert(spu, spu ? conversion : 0us)) {
+      used &= ~(1 << channel);
+      continue;
+    }
+  }
+
+  if (!spu) {
+    _bridge->wait(conversion);
+  }
+
+  for (uint8_t channel = 0; channel < channels; channel++) {
+    if (!(used & (1 << channel))) {
+      continue;
+    }
+
+    DS248X::Session session(_bridge);
+
+    if (!_bridge->selectChannel(channel)) {
+      continue;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      if (sensors[i].device.channel == channel && read(&sensors[i], fast)) {
+        done++;
+      }
+    }
+  }
+
+  return done;
+}
+
+int16_t DS248XTemperature::toRaw(uint8_t family, const char *data, bool full) {
+  int16_t raw = ((uint8_t)data[1] << 8) | (uint8_t)data[0];
+
+  switch (family) {
+    case DS248X_FAMILY_DS18S20:
+      raw = raw << 3;  // 9 bit resolution
+
+      if (full && data[7] == 0x10) {
+        raw = (raw & 0xFFF0) + 12 - data[6];
+      }
+
+      break;
+
+    case DS248X_FAMILY_DS18B20:
+      if (full) {
+        char cfg = (data[4] & 0x60);
+
+        if (cfg == 0x00) {  // 9 bit resolution
+          raw &= ~7;
+
+        } else if (cfg == 0x20) {  // 10 bit resolution
+          raw &= ~3;
+
+        } else if (cfg == 0x40) {  // 11 bit resolution
+          raw &= ~1;
+        }
+      }
+
+      break;
+
+    default:
+      break;
+  }
+
+  return raw;
+}
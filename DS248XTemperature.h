@@ -0,0 +1,113 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DS248X_TEMPERATURE_H
+#define DS248X_TEMPERATURE_H
+
+#include "DS248X.h"
+
+#define DS248X_FAMILY_DS18S20 0x10
+#define DS248X_FAMILY_DS18B20 0x28
+
+#define DS248X_TIME_CONVERSION 750ms  // 12-bit resolution
+
+/**
+ * @brief Temperature acquisition of many DS18B20/DS18S20 sensors
+ *
+ * All sensors on a channel convert at once (Skip ROM + Convert T),
+ * so a sweep takes one conversion time plus a short read per sensor.
+ */
+class DS248XTemperature {
+ public:
+  typedef struct {
+    DS248X::ds248x_device_t device;
+    int16_t raw;  // 1/16 of degree Celsius
+    bool valid;
+  } ds248x_temperature_t;
+
+  DS248XTemperature(DS248X* bridge);
+
+  /**
+   * @brief Start conversion on all sensors on the selected channel
+   *
+   * @param spu whether to assert strong pullup (parasite powered sensors)
+   * @param hold keep the strong pullup for this time and release it,
+   * 0 leaves it on until the next 1-Wire command
+   * @return true if successful, otherwise false
+   */
+  bool convert(bool spu = false, microseconds hold = 0us);
+
+  /**
+   * @brief Read result of one sensor on the selected channel
+   *
+   * @param sensor sensor to read, raw and valid get updated
+   * @param fast read just the temperature and terminate by reset, no CRC check
+   * @return true if successful, otherwise false
+   */
+  bool read(ds248x_temperature_t* sensor, bool fast = false);
+
+  /**
+   * @brief Convert and read all sensors, every channel converts once
+   *
+   * @param sensors table of sensors (ie. filled from enumerateAll())
+   * @param count number of sensors in the table
+   * @param fast read just the temperature and terminate by reset, no CRC check
+   * @param spu whether to assert strong pullup, channels then convert one by one
+   * @param conversion conversion time of the slowest sensor
+   * @param channels number of channels, limited to the channels of the bridge
+   * @return number of sensors read successfully
+   */
+  size_t acquire(ds248x_temperature_t* sensors, size_t count, bool fast = false, bool spu = false,
+                 microseconds conversion = DS248X_TIME_CONVERSION, uint8_t channels = DS248X_CHANNELS);
+
+  /**
+   * @brief Convert raw reading to millidegrees Celsius
+   *
+   * @param raw reading in 1/16 of degree Celsius
+   * @return temperature in m°C
+   */
+  static int32_t toMilliCelsius(int16_t raw) {
+    return ((int32_t)raw * 1000) >> 4;
+  }
+
+ private:
+  typedef enum {
+    COMMAND_CONVERT = 0x44,
+    COMMAND_READ_SCRATCHPAD = 0xBE,
+  } ds18b20_cmd_t;
+
+  DS248X* _bridge;
+
+  /**
+   * @brief Convert scratchpad to 1/16 of degree Celsius
+   *
+   * @param family family code of the sensor
+   * @param data scratchpad
+   * @param full whether the whole scratchpad was read
+   * @return temperature
+   */
+  static int16_t toRaw(uint8_t family, const char* data, bool full);
+};
+
+#endif  // DS248X_TEMPERATURE_H
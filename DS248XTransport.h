@@ -0,0 +1,206 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DS248X_TRANSPORT_H
+#define DS248X_TRANSPORT_H
+
+#include <chrono>
+
+#if defined(__MBED__)
+  #include "hal/us_ticker_api.h"
+  #include "mbed.h"
+#endif
+
+/**
+ * @brief I2C bus the DS248X talks through
+ *
+ * Methods follow the mbed I2C API, so the driver code stays the same
+ * whether it runs on a target or against the simulator on a host.
+ */
+class DS248XTransport {
+ public:
+  virtual ~DS248XTransport(void) {}
+
+  /**
+   * @brief Acquire exclusive access to the bus
+   *
+   */
+  virtual void lock() {}
+
+  /**
+   * @brief Release exclusive access to the bus
+   *
+   */
+  virtual void unlock() {}
+
+  /**
+   * @brief Write data to the bus
+   *
+   * @param address 8-bit I2C address
+   * @param data a pointer to the data block
+   * @param length the size of the data to be written
+   * @param repeated whether to skip the STOP condition
+   * @return 0 on ACK, non-zero on NACK
+   */
+  virtual int write(int address, const char* data, int length, bool repeated = false) = 0;
+
+  /**
+   * @brief Read data from the bus
+   *
+   * @param address 8-bit I2C address
+   * @param data place to put the reading
+   * @param length size of data to read
+   * @param repeated whether to skip the STOP condition
+   * @return 0 on ACK, non-zero on NACK
+   */
+  virtual int read(int address, char* data, int length, bool repeated = false) = 0;
+
+  /**
+   * @brief Create a STOP condition on the bus
+   *
+   * @return 0 if successful, non-zero if writes queued by the transport were not acknowledged
+   */
+  virtual int stop() = 0;
+
+  /**
+   * @brief Whether to keep the transaction open while the bridge is busy, the status
+   * read then follows the command by repeated start, otherwise STOP frees the bus meanwhile
+   *
+   * @param time how long the 1-Wire activity is expected to take
+   * @return true to keep the transaction open, false to send STOP before the wait
+   */
+  virtual bool hold(std::chrono::microseconds time) {
+    (void)time;
+    return true;
+  }
+
+  /**
+   * @brief Get monotonic time
+   *
+   * @return time since arbitrary point
+   */
+  virtual std::chrono::microseconds now() = 0;
+
+  /**
+   * @brief Wait without occupying the bus
+   *
+   * @param time how long to wait
+   */
+  virtual void wait(std::chrono::microseconds time) = 0;
+};
+
+#if defined(__MBED__)
+/**
+ * @brief Transport over the mbed I2C driver
+ *
+ */
+class DS248XI2CTransport : public DS248XTransport {
+ public:
+  DS248XI2CTransport(I2C* i2c = nullptr) : _i2c(i2c) {}
+
+  /**
+   * @brief Set the I2C object to use
+   *
+   * @param i2c I2C object
+   */
+  void attach(I2C* i2c) {
+    _i2c = i2c;
+  }
+
+  /**
+   * @brief Get the I2C object in use
+   *
+   * @return I2C object
+   */
+  I2C* get() const {
+    return _i2c;
+  }
+
+  virtual void lock() override {
+    _i2c->lock();
+  }
+
+  virtual void unlock() override {
+    _i2c->unlock();
+  }
+
+  virtual int write(int address, const char* data, int length, bool repeated = false) override {
+    return _i2c->write(address, data, length, repeated);
+  }
+
+  virtual int read(int address, char* data, int length, bool repeated = false) override {
+    return _i2c->read(address, data, length, repeated);
+  }
+
+  virtual int stop() override {
+    _i2c->stop();
+    return 0;
+  }
+
+  virtual bool hold(std::chrono::microseconds time) override {
+    return time <= std::chrono::microseconds(MBED_CONF_DS248X_HOLD_TIME);
+  }
+
+  virtual std::chrono::microseconds now() override {
+    return std::chrono::microseconds(ticker_read_us(get_us_ticker_data()));
+  }
+
+  virtual void wait(std::chrono::microseconds time) override {
+    std::chrono::microseconds deadline = now() + time;
+
+    // sleep whole ticks, the kernel may wake us up to a tick early
+    if (time >= std::chrono::milliseconds(2)) {
+      ThisThread::sleep_for(std::chrono::duration_cast<std::chrono::milliseconds>(time) - std::chrono::milliseconds(1));
+    }
+
+    time = deadline - now();
+
+  #if MBED_CONF_RTOS_PRESENT
+    // 1-Wire slots take tens of microseconds to milliseconds, let other threads run meanwhile
+    if (time > std::chrono::microseconds(MBED_CONF_DS248X_WAIT_SPIN)) {
+      _timeout.attach(callback(this, &DS248XI2CTransport::wake), time);
+      _flags.wait_any(1);
+      time = deadline - now();
+    }
+  #endif
+
+    if (time.count() > 0) {
+      wait_us(time.count());
+    }
+  }
+
+ private:
+  I2C* _i2c;
+  #if MBED_CONF_RTOS_PRESENT
+  Timeout _timeout;
+  EventFlags _flags;
+
+  void wake() {
+    _flags.set(1);
+  }
+  #endif
+};
+#endif
+
+#endif  // DS248X_TRANSPORT_H
@@ -0,0 +1,462 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Host benchmark of the I/O path on the simulated bridge, results are CSV,
+// with baseline given every metric is compared and any increase fails.
+// CPU time (CRC scenarios only) depends on the host, it is reported, not compared.
+
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "DS248XEEPROM.h"
+#include "DS248XScheduler.h"
+#include "DS248XSim.h"
+#include "DS248XTemperature.h"
+
+#define BENCH_CSV_HEADER "name,transactions,bytes_written,bytes_read,commands,bus_us,cpu_ns"
+#define BENCH_LOOPS 100
+#define BENCH_CHANNEL_DEVICES 16
+#define BENCH_BRIDGE_DEVICES 10
+#define BENCH_CRC_BYTES 65536
+
+typedef struct {
+  std::string name;
+  uint32_t transactions;
+  uint32_t bytes_written;
+  uint32_t bytes_read;
+  uint32_t commands;
+  uint64_t bus_us;
+  uint64_t cpu_ns;
+} bench_result_t;
+
+static std::vector<bench_result_t> results;
+static bool broken = false;
+
+static uint64_t serial(size_t index) {
+  // spread over the whole 48-bit space, so the search tree is not a comb
+  return ((index + 1) * 0x9E3779B97F4A7C15ULL) >> 16;
+}
+
+static microseconds begin(DS248XSim *sim) {
+  sim->resetStats();
+  return sim->elapsed();
+}
+
+static void record(const std::string &name, const DS248XSim::ds248x_sim_stats_t &stats, microseconds time,
+                   bool success) {
+  bench_result_t result = {name,
+                           stats.transactions,
+                           stats.bytes_written,
+                           stats.bytes_read,
+                           stats.commands,
+                           static_cast<uint64_t>(time.count()),
+                           0};
+
+  // numbers of a run which did not do its job are meaningless
+  if (!success) {
+    fprintf(stderr, "%s: operation failed\n", name.c_str());
+    broken = true;
+  }
+
+  results.push_back(result);
+}
+
+static void end(DS248XSim *sim, const std::string &name, microseconds start, bool success) {
+  record(name, sim->stats(), sim->elapsed() - start, success);
+}
+
+static void benchSearch(size_t count) {
+  DS248XSim sim;
+  std::vector<DS248XSimDS18B20> sensors;
+  DS248X bridge;
+  microseconds start;
+  size_t found = 0;
+  char rom[8];
+
+  sensors.reserve(count);
+
+  for (size_t i = 0; i < count; i++) {
+    sensors.emplace_back(serial(i));
+    sim.add(&sensors.back());
+  }
+
+  bridge.init(&sim);
+  start = begin(&sim);
+
+  while (bridge.search(rom)) {
+    found++;
+  }
+
+  end(&sim, "search_" + std::to_string(count), start, found == count);
+}
+
+static void benchRead() {
+  DS248XSim sim;
+  DS248XSimEEPROM memory(0x43, serial(0));
+  DS248X bridge;
+  microseconds start;
+  char command[3] = {(char)0xF0, 0x00, 0x00};  // Read Memory from 0
+  char buffer[256];
+  bool success;
+
+  sim.add(&memory);
+  bridge.init(&sim);
+
+  for (size_t len : {9, 256}) {
+    success = bridge.reset() && bridge.select(memory.rom()) && bridge.writeBytes(command, sizeof(command));
+
+    start = begin(&sim);
+    success = bridge.readBytes(buffer, len) && success;
+    end(&sim, "read_" + std::to_string(len), start, success);
+  }
+}
+
+static void benchSelectRead() {
+  DS248XSim sim;
+  DS248XSimDS18B20 sensor(serial(0));
+  DS248XSimEEPROM memory(0x2D, serial(1));
+  DS248X bridge;
+  microseconds start;
+  char buffer[9];
+  char command[3] = {(char)0xF0, 0x00, 0x00};
+  bool success = true;
+
+  sim.add(&sensor);
+  sim.add(&memory);
+  bridge.init(&sim);
+
+  // Match ROM every time
+  start = begin(&sim);
+
+  for (size_t i = 0; i < BENCH_LOOPS; i++) {
+    buffer[0] = (char)0xBE;
+    success = success && bridge.reset() && bridge.select(sensor.rom()) && bridge.writeBytes(buffer, 1) &&
+              bridge.readBytes(buffer, 9) && bridge.crc8(buffer, 9);
+  }
+
+  end(&sim, "select_read_ds18b20", start, success);
+
+  // Resume after the first one
+  success = true;
+  start = begin(&sim);
+
+  for (size_t i = 0; i < BENCH_LOOPS; i++) {
+    success = success && bridge.reset() && bridge.select(memory.rom()) && bridge.writeBytes(command, sizeof(command)) &&
+              bridge.readBytes(buffer, 8);
+  }
+
+  end(&sim, "select_read_ds2431", start, success);
+}
+
+static void benchSweep() {
+  DS248XSim sim(DS248XSim::DS2482_800);
+  std::vector<DS248XSimDS18B20> sensors;
+  DS248X::ds248x_device_t devices[DS248X_CHANNELS * BENCH_CHANNEL_DEVICES];
+  DS248XTemperature::ds248x_temperature_t readings[DS248X_CHANNELS * BENCH_CHANNEL_DEVICES];
+  uint8_t present[sizeof(devices) / sizeof(devices[0]) / 8];
+  const size_t total = sizeof(devices) / sizeof(devices[0]);
+  DS248X bridge;
+  DS248XTemperature thermometer(&bridge);
+  microseconds start;
+  size_t count = 0;
+  bool success;
+
+  sensors.reserve(total);
+
+  for (size_t i = 0; i < total; i++) {
+    sensors.emplace_back(serial(i));
+    sim.add(&sensors.back(), i % DS248X_CHANNELS);
+  }
+
+  bridge.init(&sim);
+
+  start = begin(&sim);
+  success = bridge.enumerateAll(devices, total, &count) == DS248X::EnumComplete;
+  end(&sim, "enumerate_8ch", start, success && count == total);
+
+  start = begin(&sim);
+  success = bridge.verifyAll(devices, count, present) == total;
+  end(&sim, "verify_8ch", start, success);
+
+  for (size_t i = 0; i < count; i++) {
+    readings[i].device = devices[i];
+  }
+
+  start = begin(&sim);
+  success = thermometer.acquire(readings, count) == total;
+  end(&sim, "temperature_8ch", start, success);
+
+  start = begin(&sim);
+  success = thermometer.acquire(readings, count, true) == total;
+  end(&sim, "temperature_fast_8ch", start, success);
+}
+
+static void benchBridges(size_t count) {
+  DS248XSimBus bus;
+  std::vector<DS248XSim> sims;
+  std::vector<DS248XSimDS18B20> sensors;
+  DS248X bridges[DS248X_SCHEDULER_BRIDGES] = {{DS248X_DEFAULT_ADDRESS},
+                                              {DS248X_DEFAULT_ADDRESS + 2},
+                                              {DS248X_DEFAULT_ADDRESS + 4},
+                                              {DS248X_DEFAULT_ADDRESS + 6}};
+  DS248XAsync engines[DS248X_SCHEDULER_BRIDGES] = {{&bridges[0]}, {&bridges[1]}, {&bridges[2]}, {&bridges[3]}};
+  DS248XAsync::ds248x_request_t requests[DS248X_SCHEDULER_BRIDGES];
+  DS248XScheduler scheduler;
+  char roms[DS248X_SCHEDULER_BRIDGES][8];
+  size_t found = 0;
+  microseconds start;
+  microseconds time;
+
+  sims.reserve(count);
+  sensors.reserve(count * BENCH_BRIDGE_DEVICES);
+
+  for (size_t i = 0; i < count; i++) {
+    sims.emplace_back(DS248XSim::DS2482_100, DS248X_DEFAULT_ADDRESS + 2 * i);
+    bus.add(&sims.back());
+
+    for (size_t j = 0; j < BENCH_BRIDGE_DEVICES; j++) {
+      sensors.emplace_back(serial(i * BENCH_BRIDGE_DEVICES + j));
+      sims.back().add(&sensors.back());
+    }
+
+    bridges[i].init(&bus);
+    scheduler.add(&engines[i]);
+  }
+
+  bus.resetStats();
+  start = bus.elapsed();
+
+  // every bridge searches its devices, the scheduler uses the bus of a busy bridge for the others
+  for (size_t i = 0; i < count; i++) {
+    requests[i] = {DS248XAsync::RequestSearch, roms[i], sizeof(roms[i]), false, nullptr, false, 0};
+    requests[i].done = [&, i](DS248XAsync::ds248x_request_t *request) {
+      if (request->success) {
+        found++;
+        scheduler.submit(i, request);
+      }
+    };
+
+    scheduler.submit(i, &requests[i]);
+  }
+
+  while (scheduler.busy()) {
+    time = scheduler.process();
+
+    if (time != microseconds::max()) {
+      bus.wait(time);
+    }
+  }
+
+  record("sweep_" + std::to_string(count) + "bridges", bus.stats(), bus.elapsed() - start,
+         found == count * BENCH_BRIDGE_DEVICES);
+}
+
+static void benchEEPROM() {
+  DS248XSim sim;
+  DS248XSimEEPROM memory(0x43, serial(0));
+  DS248X bridge;
+  DS248XEEPROM eeprom(&bridge, memory.rom());
+  microseconds start;
+  static char buffer[2560];
+  bool success;
+
+  for (size_t i = 0; i < sizeof(buffer); i++) {
+    buffer[i] = static_cast<char>(i * 7);
+  }
+
+  sim.add(&memory);
+  bridge.init(&sim);
+
+  start = begin(&sim);
+  success = eeprom.write(0, buffer, 256);
+  end(&sim, "eeprom_write_256", start, success);
+
+  start = begin(&sim);
+  success = eeprom.read(0, buffer, sizeof(buffer));
+  end(&sim, "eeprom_read_2560", start, success);
+}
+
+// reference for the tables, what computeCRC() did per bit before
+static uint8_t bitwise8(const char *data, size_t len) {
+  uint8_t crc = 0;
+
+  for (size_t i = 0; i < len; i++) {
+    crc ^= static_cast<uint8_t>(data[i]);
+
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0x8C : (crc >> 1);
+    }
+  }
+
+  return crc;
+}
+
+static uint16_t bitwise16(const char *data, size_t len) {
+  uint16_t crc = 0;
+
+  for (size_t i = 0; i < len; i++) {
+    crc ^= static_cast<uint8_t>(data[i]);
+
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+    }
+  }
+
+  return crc;
+}
+
+template <typename F>
+static uint64_t cpuTime(F function) {
+  steady_clock::time_point start = steady_clock::now();
+
+  function();
+
+  return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+}
+
+static void benchCRC() {
+  static char buffer[BENCH_CRC_BYTES];
+  volatile uint8_t results8[2];
+  volatile uint16_t results16[2];
+  uint64_t time8[2];
+  uint64_t time16[2];
+
+  for (size_t i = 0; i < sizeof(buffer); i++) {
+    buffer[i] = static_cast<char>(serial(i));
+  }
+
+  time8[0] = cpuTime([&]() { results8[0] = DS248XCRC::crc8(buffer, sizeof(buffer)); });
+  time8[1] = cpuTime([&]() { results8[1] = bitwise8(buffer, sizeof(buffer)); });
+  time16[0] = cpuTime([&]() { results16[0] = DS248XCRC::crc16(buffer, sizeof(buffer)); });
+  time16[1] = cpuTime([&]() { results16[1] = bitwise16(buffer, sizeof(buffer)); });
+
+  results.push_back({"crc8_table", 0, 0, sizeof(buffer), 0, 0, time8[0]});
+  results.push_back({"crc8_bitwise", 0, 0, sizeof(buffer), 0, 0, time8[1]});
+  results.push_back({"crc16_table", 0, 0, sizeof(buffer), 0, 0, time16[0]});
+  results.push_back({"crc16_bitwise", 0, 0, sizeof(buffer), 0, 0, time16[1]});
+
+  // absolute times differ between hosts, the table has to win on the same one
+  if (results8[0] != results8[1] || results16[0] != results16[1]) {
+    fprintf(stderr, "crc: table and bitwise results differ\n");
+    broken = true;
+  }
+
+  if (time8[0] >= time8[1] || time16[0] >= time16[1]) {
+    fprintf(stderr, "crc: table is not faster than bitwise\n");
+    broken = true;
+  }
+}
+
+static bool compare(const char *path) {
+  FILE *file = fopen(path, "r");
+  char line[160];
+  char name[64];
+  bench_result_t base;
+  bool regression = false;
+  size_t matched = 0;
+
+  if (file == nullptr) {
+    fprintf(stderr, "Can't open baseline %s\n", path);
+    return false;
+  }
+
+  while (fgets(line, sizeof(line), file)) {
+    if (sscanf(line, "%63[^,],%" SCNu32 ",%" SCNu32 ",%" SCNu32 ",%" SCNu32 ",%" SCNu64, name, &base.transactions,
+               &base.bytes_written, &base.bytes_read, &base.commands, &base.bus_us) != 6) {
+      continue;  // header
+    }
+
+    for (const bench_result_t &result : results) {
+      if (result.name != name) {
+        continue;
+      }
+
+      const struct {
+        const char *metric;
+        uint64_t base;
+        uint64_t current;
+      } metrics[] = {{"transactions", base.transactions, result.transactions},
+                     {"bytes_written", base.bytes_written, result.bytes_written},
+                     {"bytes_read", base.bytes_read, result.bytes_read},
+                     {"commands", base.commands, result.commands},
+                     {"bus_us", base.bus_us, result.bus_us}};
+
+      // the simulation is deterministic, no tolerance needed
+      for (const auto &metric : metrics) {
+        if (metric.current > metric.base) {
+          fprintf(stderr, "REGRESSION %s %s: %" PRIu64 " -> %" PRIu64 "\n", name, metric.metric, metric.base,
+                  metric.current);
+          regression = true;
+
+        } else if (metric.current < metric.base) {
+          fprintf(stderr, "improved %s %s: %" PRIu64 " -> %" PRIu64 ", update the baseline\n", name, metric.metric,
+                  metric.base, metric.current);
+        }
+      }
+
+      matched++;
+    }
+  }
+
+  fclose(file);
+
+  if (matched != results.size()) {
+    fprintf(stderr, "%zu of %zu benchmarks are in the baseline\n", matched, results.size());
+  }
+
+  return !regression;
+}
+
+int main(int argc, char **argv) {
+  for (size_t count : {1, 10, 100, 1000}) {
+    benchSearch(count);
+  }
+
+  benchRead();
+  benchSelectRead();
+  benchSweep();
+
+  for (size_t count : {1, 2, 4}) {
+    benchBridges(count);
+  }
+
+  benchEEPROM();
+  benchCRC();
+
+  printf(BENCH_CSV_HEADER "\n");
+
+  for (const bench_result_t &result : results) {
+    printf("%s,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu64 ",%" PRIu64 "\n", result.name.c_str(),
+           result.transactions, result.bytes_written, result.bytes_read, result.commands, result.bus_us,
+           result.cpu_ns);
+  }
+
+  if (argc > 1 && !compare(argv[1])) {
+    return 1;
+  }
+
+  return broken ? 1 : 0;
+}
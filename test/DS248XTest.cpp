@@ -0,0 +1,598 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pavel Slama
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Host tests of the driver against the simulated bridge, exit code is the number of failed checks
+
+#include <cstdio>
+
+#include "DS248XAsync.h"
+#include "DS248XLinux.h"
+#include "DS248XRegistry.h"
+#include "DS248XScheduler.h"
+#include "DS248XSim.h"
+
+#define CHECK(expr)                                                            \
+  do {                                                                         \
+    if (!(expr)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+static int failures = 0;
+
+static void testResetRestore() {
+  DS248XSim sim(DS248XSim::DS2482_800);
+  DS248XSimDS18B20 sensor(0x1234);
+  DS248X bridge;
+  DS248X other;  // another master resetting the chip, as a brown-out would
+
+  sim.add(&sensor, 3);
+
+  CHECK(bridge.init(&sim));
+  CHECK(other.init(&sim));
+  CHECK(bridge.setConfig(DS248X::ActivePullUp));
+  CHECK(bridge.selectChannel(3));
+
+  CHECK(other.deviceReset());
+  CHECK(sim.getChannel() == 0 && sim.getConfig() == 0);
+
+  // the reset is noticed by the first command, which is retried after the bridge is restored
+  CHECK(bridge.reset());
+  CHECK(sim.getChannel() == 3);
+  CHECK(sim.getConfig() == DS248X_CONFIG_APU);
+  CHECK(bridge.getChannel() == 3);
+
+  // in the middle of a transfer the operation is lost, the bridge is restored anyway
+  CHECK(bridge.select(sensor.rom()));
+  CHECK(other.deviceReset());
+  CHECK(!bridge.write((char)0xBE));
+  CHECK(sim.getChannel() == 3);
+  CHECK(sim.getConfig() == DS248X_CONFIG_APU);
+  CHECK(bridge.reset());
+
+  // recovery which finds the bridge reset and restored doesn't reset it once more
+  CHECK(other.deviceReset());
+  sim.resetStats();
+  CHECK(bridge.recover());
+  CHECK(sim.stats().channel_selects == 1);
+  CHECK(sim.getChannel() == 3);
+  CHECK(sim.getConfig() == DS248X_CONFIG_APU);
+}
+
+static void testTunePort() {
+  DS248XSim sim(DS248XSim::DS2484);
+  DS248XSimDS18B20 sensor(0x1234);
+  DS248X bridge;
+  DS248X::ds248x_device_t device = {0, {}};
+  DS248X::ds248x_port_t port;
+
+  sim.add(&sensor);
+  memcpy(device.rom, sensor.rom(), sizeof(device.rom));
+
+  // the line takes any timing, the sweep stops at the shortest distinct in-spec codes
+  CHECK(bridge.init(&sim));
+  CHECK(bridge.tunePort(&device, 1, &port));
+  CHECK(port.recovery == DS248X_PORT_RECOVERY_MIN);
+  CHECK(port.reset_low[0] == DS248X_PORT_RESET_LOW_MIN);
+  CHECK(DS248X::portTime(DS248X::PortResetLow, port.reset_low[0]) >= 480us);
+}
+
+static void testChannelSelect() {
+  DS248XSim sim(DS248XSim::DS2482_800);
+  DS248X bridge;
+  DS248X other;
+
+  CHECK(bridge.init(&sim));
+  CHECK(other.init(&sim));
+  sim.resetStats();
+
+  // CHSL only when the channel changes
+  for (uint8_t i = 0; i < 10; i++) {
+    CHECK(bridge.selectChannel(5));
+  }
+
+  CHECK(sim.stats().channel_selects == 1);
+  CHECK(bridge.selectChannel(2) && bridge.selectChannel(2));
+  CHECK(sim.stats().channel_selects == 2);
+
+  // the bridge lost the channel, the first status read sends it again
+  CHECK(other.deviceReset());
+  sim.resetStats();
+  bridge.reset();
+  CHECK(sim.stats().channel_selects == 1);
+  CHECK(sim.getChannel() == 2);
+
+  CHECK(bridge.selectChannel(2));
+  CHECK(sim.stats().channel_selects == 1);
+}
+
+// bridge which stops answering reads after a number of them
+class DS248XSimFlaky : public DS248XSim {
+ public:
+  int reads = -1;
+
+  virtual int read(int address, char *data, int length, bool repeated = false) override {
+    if (reads == 0) {
+      data[0] = (char)0xA5;  // whatever was on the bus
+      DS248XSim::stop();
+      return -1;
+    }
+
+    if (reads > 0) {
+      reads--;
+    }
+
+    return DS248XSim::read(address, data, length, repeated);
+  }
+};
+
+static void testReadCrc() {
+  DS248XSimFlaky sim;
+  DS248XSimEEPROM memory(0x2D, 1);
+  DS248X bridge;
+  char command[3] = {(char)0xF0, 0x00, 0x00};  // Read Memory from 0
+  char buffer[8];
+  uint8_t crc = 0;
+
+  for (size_t i = 0; i < sizeof(buffer); i++) {
+    memory.memory()[i] = static_cast<char>(i * 37 + 1);
+  }
+
+  sim.add(&memory);
+  CHECK(bridge.init(&sim));
+  CHECK(bridge.reset() && bridge.select(memory.rom()) && bridge.writeBytes(command, sizeof(command)));
+
+  // status and data of 3 bytes (data pointer is set once), then the status of the 4th fails
+  sim.reads = 6;
+  CHECK(!bridge.readBytes(buffer, sizeof(buffer), &crc));
+  CHECK(crc == DS248XCRC::crc8(memory.memory().data(), 3));
+}
+
+static void testCrcEvent() {
+  DS248XSim sim;
+  DS248X bridge;
+  DS248X::ds248x_event_t event;
+  const char data[2] = {0x12, 0x34};
+
+  CHECK(bridge.init(&sim));
+  CHECK(bridge.setConfig(DS248X::OverdriveSpeed));
+
+  // the check alone touches nothing, the failure is reported by the caller
+  CHECK(!bridge.crc8(data, sizeof(data)));
+  CHECK(!bridge.getEvent(&event));
+  CHECK(sim.getConfig() & DS248X_CONFIG_WS);
+
+  bridge.crcFailed();
+  CHECK(bridge.getEvent(&event) && event.type == DS248X::EventCrcError);
+  CHECK(!(sim.getConfig() & DS248X_CONFIG_WS));
+}
+
+static void testEnumerate() {
+  DS248XSim sim(DS248XSim::DS2482_800);
+  std::vector<DS248XSimDS18B20> sensors;
+  DS248X bridge;
+  DS248X::ds248x_device_t devices[8];
+  DS248X::ds248x_enum_result_t result;
+  size_t total = 0;
+  size_t user = 0;
+  size_t count;
+  char rom[8];
+
+  sensors.reserve(6);
+
+  for (size_t i = 0; i < 6; i++) {
+    sensors.emplace_back(0x2000 + i * 331);
+    sim.add(&sensors.back(), i / 3);
+  }
+
+  CHECK(bridge.init(&sim));
+
+  // search() of the user and the enumeration keep their own positions
+  CHECK(bridge.selectChannel(0) && bridge.search(rom));
+  user++;
+
+  do {
+    result = bridge.enumerateAll(devices, 2, &count, nullptr, 2);
+    total += count;
+
+    CHECK(bridge.selectChannel(0));
+
+    if (bridge.search(rom)) {
+      user++;
+    }
+  } while (result == DS248X::EnumFull);
+
+  CHECK(result == DS248X::EnumComplete);
+  CHECK(total == sensors.size());
+  CHECK(user == 3);
+
+  // shorted channel is a failure, not an empty one
+  sim.setShort(1, true);
+  result = bridge.enumerateAll(devices, 8, &count, nullptr, 2);
+  CHECK(result == DS248X::EnumFailed);
+  CHECK(count == 3);
+
+  sim.setShort(1, false);
+  sim.clear(1);
+  result = bridge.enumerateAll(devices, 8, &count, nullptr, 2);
+  CHECK(result == DS248X::EnumComplete);
+  CHECK(count == 3);
+}
+
+// bridge sharing the bus with other masters, STOP before every wait
+class DS248XSimShared : public DS248XSim {
+ public:
+  virtual bool hold(std::chrono::microseconds time) override {
+    (void)time;
+    return false;
+  }
+};
+
+static void testRepeatedStart() {
+  DS248XSim sim;
+  DS248XSimShared shared;
+  DS248XSimDS18B20 sensor(0x1234);
+  DS248XSimDS18B20 other(0x1234);
+  DS248X bridge;
+  char buffer[256];
+  char rom[8];
+#if defined(MBED_CONF_DS248X_STATS)
+  DS248X::ds248x_stats_t stats;
+#endif
+
+  sim.add(&sensor);
+  shared.add(&other);
+  CHECK(bridge.init(&sim));
+  CHECK(bridge.reset());
+  sim.resetStats();
+#if defined(MBED_CONF_DS248X_STATS)
+  bridge.resetStats();
+#endif
+
+  // byte commands and their status polls share one transaction
+  CHECK(bridge.readBytes(buffer, sizeof(buffer)));
+  CHECK(sim.stats().transactions == 1);
+
+  // reset, Search ROM byte, 64 triplets
+  CHECK(bridge.search(rom));
+  CHECK(sim.stats().transactions <= 4);
+
+#if defined(MBED_CONF_DS248X_STATS)
+  bridge.getStats(&stats);
+  CHECK(stats.i2c_transactions == sim.stats().transactions);
+#endif
+
+  // the status of each byte is addressed again after the wait
+  CHECK(bridge.init(&shared));
+  CHECK(bridge.reset());
+  shared.resetStats();
+#if defined(MBED_CONF_DS248X_STATS)
+  bridge.resetStats();
+#endif
+  CHECK(bridge.readBytes(buffer, sizeof(buffer)));
+  CHECK(shared.stats().transactions == sizeof(buffer) + 1);
+
+#if defined(MBED_CONF_DS248X_STATS)
+  bridge.getStats(&stats);
+  CHECK(stats.i2c_transactions == shared.stats().transactions);
+#endif
+}
+
+static void run(DS248XSim *sim, DS248XAsync *engine) {
+  microseconds time;
+
+  while (engine->busy()) {
+    time = engine->process();
+
+    if (time != microseconds::max()) {
+      sim->elapse(time);
+    }
+  }
+}
+
+static void testAsyncResume() {
+  DS248XSim sim;
+  DS248XSimEEPROM first(0x2D, 1);
+  DS248XSimEEPROM second(0x2D, 2);
+  DS248X bridge;
+  DS248XAsync engine(&bridge);
+  char command[3] = {(char)0xF0, 0x00, 0x00};  // Read Memory from 0
+  char rom[8];
+  char match[9];
+  char data;
+  DS248XAsync::ds248x_request_t reset = {DS248XAsync::RequestReset, nullptr, 0, false, nullptr, false, 0};
+  DS248XAsync::ds248x_request_t select = {DS248XAsync::RequestSelect, rom, sizeof(rom), false, nullptr, false, 0};
+  DS248XAsync::ds248x_request_t write = {DS248XAsync::RequestWrite, match, sizeof(match), false, nullptr, false, 0};
+
+  first.memory()[0] = 0x5A;
+  second.memory()[0] = 0x3C;
+  memcpy(rom, first.rom(), sizeof(rom));
+  match[0] = 0x55;  // Match ROM
+  memcpy(&match[1], second.rom(), sizeof(rom));
+
+  sim.add(&first);
+  sim.add(&second);
+  CHECK(bridge.init(&sim));
+
+  // Match ROM by the engine is remembered, select() resumes
+  CHECK(engine.submit(&reset) && engine.submit(&select));
+  run(&sim, &engine);
+  CHECK(bridge.reset());
+  sim.resetStats();
+  CHECK(bridge.select(first.rom()));
+  CHECK(sim.stats().bytes_written == 2);
+  CHECK(bridge.writeBytes(command, sizeof(command)) && bridge.read(&data) && data == 0x5A);
+
+  // Match ROM written as raw bytes moves the RC flag, select() must not resume
+  CHECK(engine.submit(&reset) && engine.submit(&write));
+  run(&sim, &engine);
+  CHECK(bridge.reset() && bridge.select(first.rom()));
+  CHECK(bridge.writeBytes(command, sizeof(command)) && bridge.read(&data) && data == 0x5A);
+}
+
+// time the scheduler takes to search the devices of the first count bridges
+static microseconds sweep(size_t count, size_t *found) {
+  DS248XSimBus bus;
+  DS248XSim sims[2] = {{DS248XSim::DS2482_100, DS248X_DEFAULT_ADDRESS},
+                       {DS248XSim::DS2482_100, DS248X_DEFAULT_ADDRESS + 2}};
+  DS248XSimDS18B20 sensors[2][3] = {{{0x101}, {0x102}, {0x103}}, {{0x201}, {0x202}, {0x203}}};
+  DS248X bridges[2] = {{DS248X_DEFAULT_ADDRESS}, {DS248X_DEFAULT_ADDRESS + 2}};
+  DS248XAsync engines[2] = {{&bridges[0]}, {&bridges[1]}};
+  DS248XAsync::ds248x_request_t requests[2];
+  DS248XScheduler scheduler;
+  char roms[2][8];
+  microseconds start;
+  microseconds delay;
+
+  *found = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    bus.add(&sims[i]);
+
+    for (DS248XSimDS18B20 &sensor : sensors[i]) {
+      sims[i].add(&sensor);
+    }
+
+    CHECK(bridges[i].init(&bus));
+    CHECK(scheduler.add(&engines[i]));
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    requests[i] = {DS248XAsync::RequestSearch, roms[i], sizeof(roms[i]), false, nullptr, false, 0};
+    requests[i].done = [&, i](DS248XAsync::ds248x_request_t *request) {
+      if (request->success) {
+        (*found)++;
+        scheduler.submit(i, request);
+      }
+    };
+
+    CHECK(scheduler.submit(i, &requests[i]));
+  }
+
+  start = bus.elapsed();
+
+  while (scheduler.busy()) {
+    delay = scheduler.process();
+
+    if (delay != microseconds::max()) {
+      bus.wait(delay);
+    }
+  }
+
+  return bus.elapsed() - start;
+}
+
+static void testScheduler() {
+  size_t found[2];
+  microseconds time[2];
+
+  time[0] = sweep(1, &found[0]);
+  time[1] = sweep(2, &found[1]);
+
+  // the second bridge runs while the first one is busy with 1-Wire slots
+  CHECK(found[0] == 3 && found[1] == 6);
+  CHECK(time[1] < time[0] * 5 / 4);
+}
+
+static void testRegistry() {
+  DS248XSim sim(DS248XSim::DS2482_800);
+  DS248XSimDS18B20 sensors[3] = {{0x301}, {0x302}, {0x303}};
+  DS248X bridge;
+  DS248XRegistry registry;
+  DS248XRegistry copy;
+  const DS248XRegistry::ds248x_entry_t *entry;
+  const char *blob;
+  char corrupted[sizeof(DS248XRegistry)];
+  size_t len;
+  bool searched;
+
+  sim.add(&sensors[0], 0);
+  sim.add(&sensors[1], 1);
+  CHECK(bridge.init(&sim));
+
+  // a device stored on a channel which is not checked doesn't force enumeration
+  CHECK(registry.add(sensors[0].rom(), 0, 0, 1));
+  CHECK(registry.add(sensors[1].rom(), 0, 1, 1));
+  CHECK(registry.add(sensors[2].rom(), 0, 5, 1));
+  CHECK(registry.start(&bridge, 0, 10, &searched, 2) == 2);
+  CHECK(!searched);
+
+  // confirmed devices are seen now, the unchecked one keeps its time
+  CHECK(registry.find(sensors[0].rom())->last_seen == 10);
+  CHECK(registry.find(sensors[1].rom())->last_seen == 10);
+  CHECK(registry.find(sensors[2].rom())->last_seen == 1);
+  CHECK(registry.add(sensors[2].rom(), 0, 6, 20));
+  CHECK(registry.find(sensors[2].rom())->last_seen == 20 && registry.find(sensors[2].rom())->channel == 6);
+
+  // the copy looks up the same devices
+  blob = registry.serialize(&len);
+  CHECK(copy.deserialize(blob, len));
+  CHECK(copy.count() == 3);
+
+  for (size_t i = 0; i < registry.count(); i++) {
+    entry = copy.find(registry.entry(i)->rom);
+    CHECK(entry && memcmp(entry, registry.entry(i), sizeof(*entry)) == 0);
+  }
+
+  memcpy(corrupted, blob, len);
+  corrupted[len - 1] ^= 1;
+  CHECK(!copy.deserialize(corrupted, len));
+
+  // the lookup follows the entries moved by prune()
+  CHECK(registry.prune(15) == 2);
+  CHECK(registry.count() == 1);
+  CHECK(registry.find(sensors[0].rom()) == nullptr);
+  CHECK(registry.find(sensors[1].rom()) == nullptr);
+  CHECK(registry.find(sensors[2].rom()) && registry.find(sensors[2].rom())->last_seen == 20);
+  CHECK(registry.add(sensors[0].rom(), 0, 0, 30));
+  CHECK(registry.find(sensors[0].rom()) == registry.entry(1));
+}
+
+#if defined(__linux__)
+// Linux transport with the adapter replaced by the simulator
+class DS248XSimLinux : public DS248XLinuxTransport {
+ public:
+  DS248XSimLinux(DS248XSim *sim, uint32_t frequency) : DS248XLinuxTransport(frequency), _sim(sim) {}
+
+  uint32_t messages = 0;
+  uint32_t fused = 0;  // transfers with 1-Wire command followed by status read
+
+  virtual std::chrono::microseconds now() override {
+    return _sim->now();
+  }
+
+ protected:
+  virtual int transfer(struct i2c_msg *list, size_t count) override {
+    int result;
+
+    for (size_t i = 0; i < count; i++) {
+      messages++;
+
+      if (i > 0 && (list[i].flags & I2C_M_RD) && !(list[i - 1].flags & I2C_M_RD) && wireCommand(list[i - 1].buf[0])) {
+        fused++;
+      }
+
+      if (list[i].flags & I2C_M_RD) {
+        result = _sim->read(list[i].addr << 1, reinterpret_cast<char *>(list[i].buf), list[i].len, true);
+
+      } else {
+        result = _sim->write(list[i].addr << 1, reinterpret_cast<const char *>(list[i].buf), list[i].len, true);
+      }
+
+      if (result != 0) {
+        _sim->stop();
+        return -1;
+      }
+    }
+
+    _sim->stop();
+    return count;
+  }
+
+  virtual void sleep(std::chrono::microseconds time) override {
+    _sim->wait(time);
+  }
+
+ private:
+  DS248XSim *_sim;
+
+  static bool wireCommand(uint8_t command) {
+    return command == 0xB4 || command == 0xA5 || command == 0x96 || command == 0x87 || command == 0x78;
+  }
+};
+
+static void testLinuxTransport() {
+  DS248XSim sim(DS248XSim::DS2482_100, DS248X_DEFAULT_ADDRESS, DS248X_LINUX_FREQUENCY);
+  std::vector<DS248XSimDS18B20> sensors;
+  DS248XSimLinux bus(&sim, 0);  // unknown clock falls back to the default
+  DS248X bridge;
+  const char status = (char)0xF0;
+  char scratchpad[9];
+  char buf[1];
+  size_t found = 0;
+  char rom[8];
+
+  sensors.reserve(10);
+
+  for (size_t i = 0; i < 10; i++) {
+    sensors.emplace_back(0x1000 + i * 977);
+    sim.add(&sensors.back());
+  }
+
+  CHECK(bridge.init(&bus));
+
+  while (bridge.search(rom)) {
+    found++;
+  }
+
+  CHECK(found == 10);
+
+  // a bit slot is shorter than addressing the bridge at 100 kHz, command and status share the transfer
+  bus.fused = 0;
+  CHECK(bridge.writeBit(true));
+  bridge.readBit();
+  CHECK(bus.fused == 2);
+
+  // 1-Wire reset is not, the bus is free meanwhile
+  CHECK(bridge.reset());
+  CHECK(bus.fused == 2);
+
+  // set read pointer + data read of each byte go as one transfer
+  buf[0] = (char)0xBE;  // Read Scratchpad
+  bus.messages = 0;
+  sim.resetStats();
+  CHECK(bridge.reset() && bridge.select(sensors[0].rom()) && bridge.write(buf[0]));
+  CHECK(bridge.readBytes(scratchpad, sizeof(scratchpad)) && bridge.crc8(scratchpad, sizeof(scratchpad)));
+  CHECK(bus.messages - sim.stats().transactions >= sizeof(scratchpad));
+
+  // NACK of a queued write is reported by the call which sends it, not later
+  CHECK(bus.write(DS248X_DEFAULT_ADDRESS + 2, &status, 1, true) == 0);
+  CHECK(bus.read(DS248X_DEFAULT_ADDRESS, buf, 1) != 0);
+  CHECK(bus.read(DS248X_DEFAULT_ADDRESS, buf, 1) == 0);
+
+  CHECK(bus.write(DS248X_DEFAULT_ADDRESS + 2, &status, 1, true) == 0);
+  CHECK(bus.stop() != 0);
+  CHECK(bus.write(DS248X_DEFAULT_ADDRESS, &status, 1) == 0);
+}
+#endif
+
+int main() {
+  testResetRestore();
+  testTunePort();
+  testChannelSelect();
+  testRepeatedStart();
+  testEnumerate();
+  testCrcEvent();
+  testReadCrc();
+  testAsyncResume();
+  testScheduler();
+  testRegistry();
+#if defined(__linux__)
+  testLinuxTransport();
+#endif
+
+  printf("%d failed\n", failures);
+  return failures;
+}